@@ -0,0 +1,174 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include "Logic.h"
+#include "Notation.h"
+#include "ThreadPool.h"
+
+// Пакетный анализ позиций (режим "analyze")
+// Читает позиции построчно из файла или стандартного ввода, ищет лучший ход в каждой
+// параллельно в пуле потоков и выводит результаты в формате JSON Lines в порядке ввода
+// Строка ввода: "<FEN|startpos> [moves <ход> ...]", пустые строки и строки с '#' пропускаются
+// Одновременно обрабатывается не больше нескольких позиций на поток, поэтому
+// расход памяти не зависит от размера входных данных
+class Analyzer
+{
+  public:
+    // Запуск анализа
+    // Параметры командной строки:
+    // --threads N - число потоков (по умолчанию по числу ядер)
+    // --depth D - глубина поиска (по умолчанию 6)
+    // --opt O - уровень оптимизации поиска (по умолчанию O1)
+    // --scoring S - режим оценки позиции (по умолчанию NumberAndPotential)
+    // файл - входной файл (по умолчанию или "-" - стандартный ввод)
+    // Возвращает 0 при успехе, 1 при ошибке в параметрах
+    int run(const int argc, char *argv[])
+    {
+        size_t threads = 0, depth_value = depth;
+        string input = "-", optimization = "O1", scoring = "NumberAndPotential";
+        for (int i = 0; i < argc; ++i)
+        {
+            string arg = argv[i];
+            if (i + 1 < argc && (arg == "--threads" || arg == "--depth"))
+            {
+                // Число без знака и лишних символов
+                const string value = argv[++i];
+                if (value.empty() || value.size() > 6 ||
+                    !all_of(value.begin(), value.end(), [](const char c) { return c >= '0' && c <= '9'; }))
+                {
+                    cerr << "analyze: bad value '" << value << "' of " << arg << endl;
+                    return 1;
+                }
+                if (arg == "--threads")
+                    threads = stoul(value);
+                else
+                    depth_value = stoul(value);
+            }
+            else if (i + 1 < argc && arg == "--opt")
+                optimization = argv[++i];
+            else if (i + 1 < argc && arg == "--scoring")
+                scoring = argv[++i];
+            else if (arg.size() > 1 && arg[0] == '-')
+            {
+                cerr << "analyze: unknown option " << arg << endl;
+                return 1;
+            }
+            else
+                input = arg;
+        }
+
+        depth = int(depth_value);
+
+        // Настройки проверяются до запуска пула: ошибка в потоке пула завершила бы процесс
+        config = Config(json{{"Bot", {{"NoRandom", true}, {"BotScoringType", scoring}, {"Optimization", optimization}}}});
+        if (scoring != "Number" && scoring != "NumberAndPotential" && scoring != "NNUE")
+        {
+            cerr << "analyze: unknown scoring " << scoring << endl;
+            return 1;
+        }
+        try
+        {
+            Logic check(nullptr, &config);
+        }
+        catch (const exception &e)
+        {
+            cerr << "analyze: " << e.what() << endl;
+            return 1;
+        }
+
+        ifstream fin;
+        if (input != "-")
+        {
+            fin.open(input);
+            if (!fin)
+            {
+                cerr << "analyze: can't open " << input << endl;
+                return 1;
+            }
+        }
+        istream &in = (input == "-") ? cin : fin;
+
+        ThreadPool pool(threads, 1);
+        const uint64_t max_in_flight = 4 * pool.size();
+        uint64_t id = 0;
+        string line;
+        while (getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            {
+                // Ждем, пока не будут выведены достаточно старые результаты
+                unique_lock<mutex> lock(out_mtx);
+                out_cv.wait(lock, [&] { return id - next_out < max_in_flight; });
+            }
+            pool.submit([this, id, line] { finish(id, analyze(id, line)); });
+            ++id;
+        }
+        pool.wait();
+        return 0;
+    }
+
+  private:
+    // Анализ одной позиции
+    // Возвращает строку JSON с лучшим ходом, оценкой, глубиной и числом позиций
+    // или с описанием ошибки разбора
+    string analyze(const uint64_t id, const string &line)
+    {
+        nlohmann::ordered_json res{{"id", id}};
+        try
+        {
+            Logic logic(nullptr, &config);
+            logic.Max_depth = depth;
+            const game_position pos = Notation::parse_position(logic, line);
+            res["fen"] = Notation::to_fen(pos);
+            if (logic.find_chains(pos.color, pos.mtx).empty())
+            {
+                res["best"] = nullptr;
+                res["score"] = -INF;
+                res["depth"] = 0;
+                res["nodes"] = 0;
+                return res.dump();
+            }
+            auto start = chrono::steady_clock::now();
+            const auto turns = logic.find_best_turns(pos.mtx, pos.color);
+            auto end = chrono::steady_clock::now();
+            res["best"] = Notation::move_to_string(turns);
+            res["score"] = logic.last_score;
+            res["depth"] = depth;
+            res["nodes"] = logic.nodes;
+            res["time_ms"] = int64_t(chrono::duration<double, milli>(end - start).count());
+        }
+        catch (const exception &e)
+        {
+            res["input"] = line;
+            res["error"] = e.what();
+        }
+        return res.dump();
+    }
+
+    // Сохраняет результат и выводит все готовые результаты по порядку
+    void finish(const uint64_t id, string result)
+    {
+        unique_lock<mutex> lock(out_mtx);
+        done[id] = std::move(result);
+        while (!done.empty() && done.begin()->first == next_out)
+        {
+            cout << done.begin()->second << "\n";
+            done.erase(done.begin());
+            ++next_out;
+        }
+        cout.flush();
+        out_cv.notify_all();
+    }
+
+    Config config{json::object()};  // Настройки бота для анализа
+    int depth = 6;                  // Глубина поиска
+    mutex out_mtx;
+    condition_variable out_cv;      // Выведены очередные результаты
+    map<uint64_t, string> done;     // Готовые, но еще не выведенные результаты
+    uint64_t next_out = 0;          // Номер следующего выводимого результата
+};
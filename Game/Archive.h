@@ -0,0 +1,693 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Models/Archive.h"
+#include "BinaryFile.h"
+#include "Logic.h"
+#include "Notation.h"
+#include "Zobrist.h"
+
+// Архив партий и индекс позиций по нему (режим "archive")
+//
+// Архив - файл, который только дополняется: заголовок (16 байт) "CKGA", uint32 версия,
+// uint32 размер заголовка партии, uint32 0 (резерв), затем партии подряд: заголовок archive_game
+// и упакованные ходы. Все партии начинаются с начальной расстановки русских шашек
+// Ход упакован в номера черных клеток пути (Rules::square, 0-31): начальная клетка и клетка после
+// каждого шага, у последней клетки хода выставлен старший бит. Тихий ход занимает 2 байта,
+// серия из k взятий - k + 1 байт. Ходы распаковываются без генератора ходов: побитая шашка -
+// единственная шашка на диагонали шага, превращение - по правилам варианта
+//
+// Индекс (файл "<архив>.idx"): заголовок (32 байта) "CKGI", uint32 версия, uint64 число партий,
+// uint64 число записей, uint64 размер проиндексированной части архива, затем записи archive_posting
+// для каждой позиции каждой партии, упорядоченные по хешу позиции, номеру партии и полуходу
+// Индекс отображается в память, запрос - двоичный поиск хеша и проход по его записям, поэтому
+// время запроса зависит от числа партий с этой позицией, а не от размера архива
+// Индекс строится заново по всему архиву внешней сортировкой (см. ArchiveIndex::build); партии,
+// дописанные позже, в запросах не видны, пока индекс не перестроен
+namespace game_archive
+{
+typedef RussianRules Rules;
+
+const uint32_t VERSION = 1;
+const size_t HEADER_SIZE = 16;
+const uint32_t INDEX_VERSION = 1;
+const uint8_t LAST = 0x80;  // Признак последней клетки хода
+
+// Заголовок файла индекса
+struct index_header
+{
+    char magic[4];           // "CKGI"
+    uint32_t version;
+    uint64_t games;          // Число проиндексированных партий
+    uint64_t postings;       // Число записей
+    uint64_t archive_bytes;  // Размер проиндексированной части архива
+};
+
+static_assert(sizeof(index_header) == 32, "index_header must stay 32 bytes: it is the file format");
+
+// Проверка заголовка архива, бросает runtime_error при несовпадении формата
+inline void check_header(const char *header, const std::string &path)
+{
+    uint32_t fields[3];
+    std::memcpy(fields, header + 4, sizeof(fields));
+    if (std::memcmp(header, "CKGA", 4) != 0 || fields[0] != VERSION || fields[1] != sizeof(archive_game))
+        throw std::runtime_error("bad game archive header in '" + path + "'");
+}
+
+// Клетка доски с номером s (обратное к Rules::square)
+inline std::pair<POS_T, POS_T> cell(const int s)
+{
+    const POS_T i = POS_T(s / Rules::HALF);
+    return {i, POS_T(2 * (s % Rules::HALF) + (i % 2 == 0 ? 1 : 0))};
+}
+
+// Ключ очереди хода черных в хеше Зобриста
+inline uint64_t side_key()
+{
+    static const uint64_t key =
+        Zobrist::hash(std::vector<std::vector<POS_T>>(Rules::SIZE, std::vector<POS_T>(Rules::SIZE, 0)), true);
+    return key;
+}
+
+// Упаковка полного хода path в конец out
+inline void pack(const std::vector<move_pos> &path, std::vector<uint8_t> &out)
+{
+    out.push_back(uint8_t(Rules::square(path.front().x, path.front().y)));
+    for (size_t i = 0; i < path.size(); ++i)
+        out.push_back(uint8_t(Rules::square(path[i].x2, path[i].y2) | (i + 1 == path.size() ? LAST : 0)));
+}
+
+// Распаковка и выполнение полного хода игрока color (true - черные, false - белые)
+// Параметры:
+// mtx - доска, на которой выполняется ход
+// p - начало упакованного хода, после вызова указывает на следующий ход; end - конец ходов партии
+// hash - хеш позиции по Зобристу, обновляется вместе с доской
+// path - если не nullptr, в него дописываются шаги хода
+// Бросает runtime_error, если ход не может быть выполнен (поврежденный архив)
+inline void play(std::vector<std::vector<POS_T>> &mtx, const bool color, const uint8_t *&p, const uint8_t *end,
+                 uint64_t &hash, std::vector<move_pos> *path = nullptr)
+{
+    if (p == end || *p >= Rules::SQUARES)
+        throw std::runtime_error("corrupt game archive: bad move");
+    auto from = cell(*p++);
+    bool last = false;
+    while (!last)
+    {
+        if (p == end || (*p & ~LAST) >= Rules::SQUARES)
+            throw std::runtime_error("corrupt game archive: bad move");
+        const auto to = cell(*p & ~LAST);
+        last = (*p++ & LAST) != 0;
+        POS_T type = mtx[from.first][from.second];
+        const int dist = std::abs(to.first - from.first);
+        if (type == 0 || (type % 2 == 0) != color || mtx[to.first][to.second] != 0 || dist == 0 ||
+            dist != std::abs(to.second - from.second))
+            throw std::runtime_error("corrupt game archive: illegal move");
+        // Побитая шашка - единственная шашка между начальной и конечной клетками шага
+        const POS_T dx = to.first > from.first ? 1 : -1, dy = to.second > from.second ? 1 : -1;
+        POS_T xb = -1, yb = -1;
+        for (POS_T x = from.first + dx, y = from.second + dy; x != to.first; x += dx, y += dy)
+        {
+            if (!mtx[x][y])
+                continue;
+            if (xb != -1)
+                throw std::runtime_error("corrupt game archive: illegal move");
+            xb = x;
+            yb = y;
+        }
+        if (xb != -1)
+        {
+            hash ^= Zobrist::piece(xb, yb, mtx[xb][yb]);
+            mtx[xb][yb] = 0;
+        }
+        hash ^= Zobrist::piece(from.first, from.second, type);
+        mtx[from.first][from.second] = 0;
+        if (type <= 2 && to.first == Rules::promotion_row(type) && (Rules::PROMOTE_IN_CAPTURE || last))
+            type += 2;
+        mtx[to.first][to.second] = type;
+        hash ^= Zobrist::piece(to.first, to.second, type);
+        if (path)
+            path->push_back(xb != -1 ? move_pos(from.first, from.second, to.first, to.second, xb, yb)
+                                     : move_pos(from.first, from.second, to.first, to.second));
+        from = to;
+    }
+    hash ^= side_key();
+}
+
+// Заголовок нового архива
+inline std::string header()
+{
+    const uint32_t fields[3] = {VERSION, sizeof(archive_game), 0};
+    return std::string("CKGA", 4) + std::string(reinterpret_cast<const char *>(fields), sizeof(fields));
+}
+
+// Проход по партиям архива data размером bytes (заголовок архива уже проверен)
+// Если offsets не nullptr, в него записываются смещения партий
+// Возвращает размер начала архива из заголовка и целых партий (недописанная последняя партия не входит)
+inline size_t scan(const char *data, const size_t bytes, std::vector<size_t> *offsets = nullptr)
+{
+    size_t offset = HEADER_SIZE;
+    while (offset + sizeof(archive_game) <= bytes)
+    {
+        archive_game game;
+        std::memcpy(&game, data + offset, sizeof(game));
+        if (offset + sizeof(game) + game.size > bytes)
+            break;
+        if (offsets)
+            offsets->push_back(offset);
+        offset += sizeof(game) + game.size;
+    }
+    return offset;
+}
+} // namespace game_archive
+
+// Запись партий в конец архива (можно вызывать из нескольких потоков)
+class ArchiveWriter
+{
+  public:
+    // Открывает архив для дополнения, пустой или новый файл получает заголовок
+    // Недописанная последняя партия (если запись прервалась) отрезается, иначе читатель остановился бы
+    // на ней и не увидел бы новые партии
+    // Бросает runtime_error, если файл не открывается или имеет другой формат
+    explicit ArchiveWriter(const std::string &path)
+        : path(path), file(path, "game archive", game_archive::header(),
+                           [&path](const char *header) { game_archive::check_header(header, path); },
+                           [](const char *data, const size_t bytes) { return game_archive::scan(data, bytes); })
+    {
+    }
+
+    // Добавляет партию из начальной расстановки
+    // Параметры:
+    // moves - полные ходы партии (шаги каждого хода)
+    // result - итог для белых: 1 - победа, 0 - ничья, -1 - поражение
+    void append(const std::vector<std::vector<move_pos>> &moves, const int result)
+    {
+        std::vector<uint8_t> packed;
+        for (const auto &path : moves)
+            game_archive::pack(path, packed);
+        if (moves.size() > UINT16_MAX || packed.size() > UINT16_MAX)
+            throw std::runtime_error("game is too long for game archive '" + path + "'");
+        const archive_game game{uint32_t(std::time(nullptr)), uint16_t(moves.size()), uint16_t(packed.size()),
+                                int8_t(result), {0, 0, 0}};
+        std::lock_guard<std::mutex> lock(mtx);
+        file.write(&game, sizeof(game));
+        file.write(packed.data(), packed.size());
+        file.flush();
+        ++written;
+    }
+
+    // Число партий, добавленных этим объектом
+    uint64_t count() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return written;
+    }
+
+  private:
+    std::string path;
+    AppendFile file;
+    mutable std::mutex mtx;
+    uint64_t written = 0;
+};
+
+// Чтение архива: файл отображается в память, при открытии запоминаются начала партий
+class ArchiveReader
+{
+  public:
+    // Функция, вызываемая для каждой позиции партии:
+    // ply - число сделанных полуходов, mtx - доска, color - чей ход, hash - хеш позиции
+    typedef std::function<void(int ply, const std::vector<std::vector<POS_T>> &mtx, bool color, uint64_t hash)>
+        Visitor;
+
+    // Бросает runtime_error, если файл не открывается или имеет другой формат
+    explicit ArchiveReader(const std::string &path) : file(path, "game archive")
+    {
+        if (file.bytes < game_archive::HEADER_SIZE)
+            throw std::runtime_error("truncated game archive header in '" + path + "'");
+        game_archive::check_header(file.data, path);
+        // Недописанная последняя партия (если запись прервалась) не учитывается
+        used = game_archive::scan(file.data, file.bytes, &offsets);
+    }
+
+    // Число партий в архиве
+    size_t size() const
+    {
+        return offsets.size();
+    }
+
+    // Размер прочитанной части архива в байтах
+    size_t bytes() const
+    {
+        return used;
+    }
+
+    // Заголовок партии i
+    archive_game game(const size_t i) const
+    {
+        archive_game game;
+        std::memcpy(&game, file.data + offsets[i], sizeof(game));
+        return game;
+    }
+
+    // Проигрывание партии i: visit вызывается для начальной позиции и для позиции после каждого полухода
+    // Если moves не nullptr, в него записываются ходы партии
+    // Бросает runtime_error, если партия повреждена
+    void replay(const size_t i, const Visitor &visit, std::vector<std::vector<move_pos>> *moves = nullptr) const
+    {
+        const archive_game header = game(i);
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(file.data + offsets[i] + sizeof(header));
+        const uint8_t *end = p + header.size;
+        auto mtx = Board::start_mtx<game_archive::Rules>();
+        bool color = false;
+        uint64_t hash = Zobrist::hash(mtx, color);
+        if (visit)
+            visit(0, mtx, color, hash);
+        if (moves)
+            moves->assign(header.plies, {});
+        for (int ply = 0; ply < header.plies; ++ply)
+        {
+            game_archive::play(mtx, color, p, end, hash, moves ? &(*moves)[ply] : nullptr);
+            color = !color;
+            if (visit)
+                visit(ply + 1, mtx, color, hash);
+        }
+    }
+
+    // Партия i в формате PDN
+    std::string pdn(const size_t i) const
+    {
+        std::vector<std::vector<move_pos>> moves;
+        replay(i, nullptr, &moves);
+        Notation::pdn_game res{game_position{Board::start_mtx(), false}, {}, "1/2-1/2"};
+        for (auto &path : moves)
+        {
+            res.moves.emplace_back();
+            res.moves.back().path = path;
+        }
+        const int result = game(i).result;
+        if (result)
+            res.result = result > 0 ? "1-0" : "0-1";
+        return Notation::write_pdn(res);
+    }
+
+  private:
+    MappedFile file;
+    std::vector<size_t> offsets;  // Смещения партий в файле
+    size_t used = 0;
+};
+
+// Индекс позиций архива: по хешу позиции - партии, в которых она встретилась, и их итоги
+class ArchiveIndex
+{
+  public:
+    // Построение индекса всех партий reader в файл path (файл заменяется целиком, когда индекс готов)
+    // Партии разбираются в threads потоках (0 - по числу ядер)
+    // Внешняя сортировка: поток копит не больше RUN_POSTINGS записей, сортирует их и сбрасывает
+    // во временный файл-серию рядом с индексом, затем все серии сливаются в индекс за один проход,
+    // поэтому память построения ограничена независимо от размера архива
+    // Возвращает число записей индекса. Бросает runtime_error при ошибке записи или поврежденном архиве
+    static uint64_t build(const ArchiveReader &reader, const std::string &path, size_t threads)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::max<size_t>(1, std::min(threads, reader.size()));
+        RunFiles runs;
+        std::vector<std::vector<std::string>> thread_runs(threads);
+        std::vector<std::string> errors(threads);
+        {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t)
+            {
+                workers.emplace_back([&, t] {
+                    try
+                    {
+                        std::vector<archive_posting> buffer;
+                        buffer.reserve(std::min<size_t>(RUN_POSTINGS, 1 << 16));
+                        const auto flush = [&] {
+                            std::sort(buffer.begin(), buffer.end(), less);
+                            thread_runs[t].push_back(path + ".run" + std::to_string(t) + "-" +
+                                                     std::to_string(thread_runs[t].size()));
+                            write_run(thread_runs[t].back(), buffer);
+                            buffer.clear();
+                        };
+                        const size_t begin = reader.size() * t / threads, end = reader.size() * (t + 1) / threads;
+                        for (size_t g = begin; g < end; ++g)
+                        {
+                            const int8_t result = reader.game(g).result;
+                            reader.replay(g, [&](int ply, const std::vector<std::vector<POS_T>> &, bool,
+                                                 uint64_t hash) {
+                                buffer.push_back(archive_posting{hash, uint32_t(g), uint16_t(ply), result, 0});
+                                if (buffer.size() == RUN_POSTINGS)
+                                    flush();
+                            });
+                        }
+                        if (!buffer.empty())
+                            flush();
+                    }
+                    catch (const std::exception &e)
+                    {
+                        errors[t] = e.what();
+                    }
+                });
+            }
+            for (auto &worker : workers)
+                worker.join();
+        }
+        for (const auto &names : thread_runs)
+            runs.names.insert(runs.names.end(), names.begin(), names.end());
+        for (const auto &error : errors)
+        {
+            if (!error.empty())
+                throw std::runtime_error(error);
+        }
+
+        // Слияние серий: куча из текущих записей серий, на вершине - наименьшая
+        std::vector<RunReader> readers;
+        readers.reserve(runs.names.size());
+        uint64_t total = 0;
+        for (const auto &name : runs.names)
+        {
+            readers.emplace_back(name);
+            total += readers.back().size;
+        }
+        typedef std::pair<archive_posting, size_t> Head;  // Запись и номер ее серии
+        const auto greater = [](const Head &a, const Head &b) { return less(b.first, a.first); };
+        std::vector<Head> heap;
+        for (size_t i = 0; i < readers.size(); ++i)
+        {
+            archive_posting posting;
+            if (readers[i].next(posting))
+                heap.emplace_back(posting, i);
+        }
+        std::make_heap(heap.begin(), heap.end(), greater);
+
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream fout(tmp, std::ios::binary | std::ios::trunc);
+            game_archive::index_header header{{'C', 'K', 'G', 'I'}, game_archive::INDEX_VERSION, reader.size(),
+                                              total, reader.bytes()};
+            fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            std::vector<archive_posting> out;
+            out.reserve(RUN_CHUNK);
+            while (!heap.empty())
+            {
+                std::pop_heap(heap.begin(), heap.end(), greater);
+                Head &head = heap.back();
+                out.push_back(head.first);
+                if (readers[head.second].next(head.first))
+                    std::push_heap(heap.begin(), heap.end(), greater);
+                else
+                    heap.pop_back();
+                if (out.size() == RUN_CHUNK || heap.empty())
+                {
+                    fout.write(reinterpret_cast<const char *>(out.data()), out.size() * sizeof(archive_posting));
+                    out.clear();
+                }
+            }
+            if (!fout.flush())
+                throw std::runtime_error("can't write archive index '" + tmp + "'");
+        }
+        readers.clear();
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        if (ec)
+            throw std::runtime_error("can't replace archive index '" + path + "': " + ec.message());
+        return total;
+    }
+
+    // Бросает runtime_error, если файл не открывается или имеет другой формат
+    explicit ArchiveIndex(const std::string &path) : file(path, "archive index")
+    {
+        if (file.bytes < sizeof(header))
+            throw std::runtime_error("truncated archive index header in '" + path + "'");
+        std::memcpy(&header, file.data, sizeof(header));
+        if (std::memcmp(header.magic, "CKGI", 4) != 0 || header.version != game_archive::INDEX_VERSION ||
+            sizeof(header) + header.postings * sizeof(archive_posting) > file.bytes)
+            throw std::runtime_error("bad archive index header in '" + path + "' (rebuild it with archive index)");
+        postings = reinterpret_cast<const archive_posting *>(file.data + sizeof(header));
+    }
+
+    // Статистика позиции с хешем hash: число партий с ней, их итоги и первые list вхождений
+    // (партия учитывается один раз, даже если позиция в ней повторялась)
+    position_stats query(const uint64_t hash, const size_t list) const
+    {
+        position_stats res;
+        const archive_posting *end = postings + header.postings;
+        const archive_posting *it = std::lower_bound(
+            postings, end, hash, [](const archive_posting &p, const uint64_t h) { return p.hash < h; });
+        for (uint32_t last = UINT32_MAX; it != end && it->hash == hash; ++it)
+        {
+            if (it->game == last)
+                continue;
+            last = it->game;
+            ++res.games;
+            if (it->result > 0)
+                ++res.white;
+            else if (it->result < 0)
+                ++res.black;
+            else
+                ++res.draws;
+            if (res.postings.size() < list)
+                res.postings.emplace_back(it->game, it->ply);
+        }
+        return res;
+    }
+
+    // Число проиндексированных партий
+    uint64_t games() const
+    {
+        return header.games;
+    }
+
+    // Размер проиндексированной части архива (если архив больше, индекс устарел)
+    uint64_t archive_bytes() const
+    {
+        return header.archive_bytes;
+    }
+
+  private:
+    static constexpr size_t RUN_POSTINGS = size_t(1) << 21;  // Записей в серии (32 МБ памяти на поток)
+    static constexpr size_t RUN_CHUNK = 4096;                // Записей в буфере чтения серии и записи индекса
+
+    static bool less(const archive_posting &a, const archive_posting &b)
+    {
+        if (a.hash != b.hash)
+            return a.hash < b.hash;
+        return a.game != b.game ? a.game < b.game : a.ply < b.ply;
+    }
+
+    // Временные файлы серий, удаляются при любом выходе из build
+    struct RunFiles
+    {
+        std::vector<std::string> names;
+
+        ~RunFiles()
+        {
+            std::error_code ec;
+            for (const auto &name : names)
+                std::filesystem::remove(name, ec);
+        }
+    };
+
+    // Запись отсортированной серии в файл name
+    static void write_run(const std::string &name, const std::vector<archive_posting> &postings)
+    {
+        std::ofstream fout(name, std::ios::binary | std::ios::trunc);
+        fout.write(reinterpret_cast<const char *>(postings.data()), postings.size() * sizeof(archive_posting));
+        if (!fout.flush())
+            throw std::runtime_error("can't write archive index run '" + name + "'");
+    }
+
+    // Последовательное чтение серии порциями по RUN_CHUNK записей
+    struct RunReader
+    {
+        explicit RunReader(const std::string &name) : name(name), in(name, std::ios::binary)
+        {
+            std::error_code ec;
+            size = std::filesystem::file_size(name, ec) / sizeof(archive_posting);
+            if (!in || ec)
+                throw std::runtime_error("can't read archive index run '" + name + "'");
+        }
+
+        // Следующая запись серии; false, если серия закончилась
+        bool next(archive_posting &posting)
+        {
+            if (pos == buffer.size())
+            {
+                if (read == size)
+                    return false;
+                buffer.resize(std::min<uint64_t>(RUN_CHUNK, size - read));
+                if (!in.read(reinterpret_cast<char *>(buffer.data()), buffer.size() * sizeof(archive_posting)))
+                    throw std::runtime_error("can't read archive index run '" + name + "'");
+                read += buffer.size();
+                pos = 0;
+            }
+            posting = buffer[pos++];
+            return true;
+        }
+
+        std::string name;
+        std::ifstream in;
+        uint64_t size = 0;  // Число записей в серии
+        uint64_t read = 0;  // Число прочитанных записей
+        std::vector<archive_posting> buffer;
+        size_t pos = 0;
+    };
+
+    MappedFile file;
+    game_archive::index_header header{};
+    const archive_posting *postings = nullptr;
+};
+
+// Консольный режим "archive"
+class Archive
+{
+  public:
+    // Параметры командной строки: <команда> <архив> [параметры]
+    // index <архив> [--threads N] - построение индекса позиций "<архив>.idx"
+    // query <архив> [--list N] [файл] - статистика позиций из файла или стандартного ввода
+    //   (строки как в режиме analyze); для каждой выводится строка JSON с числом партий, итогами,
+    //   временем запроса и первыми N вхождениями (партия, полуход), по умолчанию N = 10
+    // show <архив> N - партия с номером N (с нуля) в формате PDN
+    // Возвращает 0 при успехе, 1 при ошибке
+    int run(const int argc, char *argv[])
+    {
+        if (argc < 2)
+        {
+            cerr << "archive: usage: archive <index|query|show> <archive> [options]" << endl;
+            return 1;
+        }
+        const string command = argv[0], path = argv[1];
+        try
+        {
+            if (command == "index")
+                return index(path, argc - 2, argv + 2);
+            if (command == "query")
+                return query(path, argc - 2, argv + 2);
+            if (command == "show" && argc == 3)
+            {
+                const ArchiveReader reader(path);
+                const size_t n = stoul(argv[2]);
+                if (n >= reader.size())
+                {
+                    cerr << "archive: no game " << n << " (" << reader.size() << " games)" << endl;
+                    return 1;
+                }
+                cout << reader.pdn(n);
+                return 0;
+            }
+        }
+        catch (const exception &e)
+        {
+            cerr << "archive: " << e.what() << endl;
+            return 1;
+        }
+        cerr << "archive: unknown command " << command << endl;
+        return 1;
+    }
+
+  private:
+    int index(const string &path, const int argc, char *argv[])
+    {
+        size_t threads = 0;
+        for (int i = 0; i < argc; ++i)
+        {
+            string arg = argv[i];
+            if (i + 1 < argc && arg == "--threads")
+                threads = stoul(argv[++i]);
+            else
+            {
+                cerr << "archive: unknown option " << arg << endl;
+                return 1;
+            }
+        }
+        const auto start = chrono::steady_clock::now();
+        const ArchiveReader reader(path);
+        const uint64_t postings = ArchiveIndex::build(reader, path + ".idx", threads);
+        const double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "Games     : " << reader.size() << "\n";
+        cout << "Postings  : " << postings << "\n";
+        cout << "Time (s)  : " << sec << "\n";
+        cout << "Index     : " << path << ".idx" << endl;
+        return 0;
+    }
+
+    int query(const string &path, const int argc, char *argv[])
+    {
+        size_t list = 10;
+        string input = "-";
+        for (int i = 0; i < argc; ++i)
+        {
+            string arg = argv[i];
+            if (i + 1 < argc && arg == "--list")
+                list = stoul(argv[++i]);
+            else if (arg.size() > 1 && arg[0] == '-')
+            {
+                cerr << "archive: unknown option " << arg << endl;
+                return 1;
+            }
+            else
+                input = arg;
+        }
+        const ArchiveIndex index(path + ".idx");
+        std::error_code ec;
+        const auto archive_bytes = filesystem::file_size(path, ec);
+        if (!ec && archive_bytes > index.archive_bytes())
+            cerr << "archive: index covers " << index.games() << " games, newer games are not indexed "
+                 << "(run archive index " << path << ")" << endl;
+
+        ifstream fin;
+        if (input != "-")
+        {
+            fin.open(input);
+            if (!fin)
+            {
+                cerr << "archive: can't open " << input << endl;
+                return 1;
+            }
+        }
+        istream &in = input != "-" ? fin : cin;
+        Config config(json{{"Bot", {{"NoRandom", true}, {"BotScoringType", "Number"}, {"Optimization", "O0"}}}});
+        Logic logic(nullptr, &config);
+        string line;
+        while (getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            nlohmann::ordered_json res{{"position", line}};
+            try
+            {
+                const game_position pos = Notation::parse_position(logic, line);
+                const auto start = chrono::steady_clock::now();
+                const position_stats stats = index.query(Zobrist::hash(pos.mtx, pos.color), list);
+                const auto us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+                res["games"] = stats.games;
+                res["white"] = stats.white;
+                res["draws"] = stats.draws;
+                res["black"] = stats.black;
+                res["time_us"] = us.count();
+                res["postings"] = json::array();
+                for (const auto &posting : stats.postings)
+                    res["postings"].push_back({posting.first, posting.second});
+            }
+            catch (const exception &e)
+            {
+                res["error"] = e.what();
+            }
+            cout << res.dump() << endl;
+        }
+        return 0;
+    }
+};
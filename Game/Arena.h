@@ -0,0 +1,198 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Линейный распределитель памяти (арена) для временных данных поиска
+// Память выделяется сдвигом указателя внутри больших блоков и не освобождается по одному объекту:
+// поиск запоминает положение арены (mark) и возвращается к нему (release), когда данные
+// позиции больше не нужны, а в начале каждого поиска арена сбрасывается (reset).
+// Блоки после сброса переиспользуются, поэтому после прогрева поиск не обращается к куче
+//
+// Арена привязывается к потоку через Arena::Scope: распределитель ArenaAllocator,
+// созданный в этом потоке внутри Scope, берет память из арены, а вне Scope - из кучи
+class Arena
+{
+  public:
+    // Положение арены: номер блока и смещение в нем
+    struct Mark
+    {
+        size_t block = 0;
+        size_t used = 0;
+    };
+
+    // Параметр block_size - размер блока в байтах
+    explicit Arena(const size_t block_size = 64 * 1024) : block_size(block_size)
+    {
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // Выделение bytes байт с выравниванием align
+    void *allocate(const size_t bytes, const size_t align)
+    {
+        for (; pos.block < blocks.size(); ++pos.block, pos.used = 0)
+        {
+            const size_t offset = (pos.used + align - 1) & ~(align - 1);
+            if (offset + bytes <= blocks[pos.block].size)
+            {
+                pos.used = offset + bytes;
+                return blocks[pos.block].data.get() + offset;
+            }
+        }
+        // Все блоки заняты - добавляем новый (только при прогреве или для данных больше блока)
+        blocks.emplace_back(std::max(block_size, bytes + align));
+        return allocate(bytes, align);
+    }
+
+    // Текущее положение арены
+    Mark mark() const
+    {
+        return pos;
+    }
+
+    // Возврат к положению m: вся память, выделенная после mark(), снова свободна
+    void release(const Mark m)
+    {
+        pos = m;
+    }
+
+    // Освобождение всей памяти арены (блоки сохраняются для следующего поиска)
+    void reset()
+    {
+        pos = Mark{};
+    }
+
+    // Арена текущего потока (nullptr - память берется из кучи)
+    // Функция не встраивается: адрес переменной потока вычисляется заново при каждом вызове,
+    // поэтому поиск в сопрограмме, продолженной в другом потоке, видит арену этого потока (см. Coroutine.h)
+#ifdef _MSC_VER
+    __declspec(noinline)
+#else
+    __attribute__((noinline))
+#endif
+    static Arena *&current()
+    {
+        thread_local Arena *arena = nullptr;
+        return arena;
+    }
+
+#ifndef NDEBUG
+    // Счетчик всех выделений памяти в куче во всех потоках (только в отладочной сборке, его
+    // увеличивает глобальный operator new, замененный в main.cpp): после прогрева поиск не должен
+    // его увеличивать
+    static std::atomic<uint64_t> &heap_allocations()
+    {
+        static std::atomic<uint64_t> count{0};
+        return count;
+    }
+#endif
+
+    // Привязка арены к текущему потоку на время жизни объекта
+    class Scope
+    {
+      public:
+        explicit Scope(Arena &arena) : prev(current())
+        {
+            current() = &arena;
+        }
+        ~Scope()
+        {
+            current() = prev;
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        Arena *prev;
+    };
+
+    // Возврат арены текущего потока к положению на момент создания объекта при выходе из области видимости
+    class Rewind
+    {
+      public:
+        Rewind() : arena(current()), saved(arena ? arena->mark() : Mark{})
+        {
+        }
+        ~Rewind()
+        {
+            if (arena)
+                arena->release(saved);
+        }
+
+        Rewind(const Rewind &) = delete;
+        Rewind &operator=(const Rewind &) = delete;
+
+      private:
+        Arena *arena;
+        Mark saved;
+    };
+
+  private:
+    struct Block
+    {
+        explicit Block(const size_t size) : data(new char[size]), size(size)
+        {
+        }
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    const size_t block_size;
+    std::vector<Block> blocks;
+    Mark pos;
+};
+
+// Распределитель памяти для контейнеров STL поверх арены текущего потока
+// Арена запоминается при создании распределителя; освобождение памяти в арене ничего не делает
+template <class T> class ArenaAllocator
+{
+  public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() : arena(Arena::current())
+    {
+    }
+
+    template <class U> ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena)
+    {
+    }
+
+    T *allocate(const size_t n)
+    {
+        if (arena)
+            return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, const size_t)
+    {
+        if (!arena)
+            ::operator delete(p);
+    }
+
+    template <class U> bool operator==(const ArenaAllocator<U> &other) const
+    {
+        return arena == other.arena;
+    }
+    template <class U> bool operator!=(const ArenaAllocator<U> &other) const
+    {
+        return arena != other.arena;
+    }
+
+  private:
+    template <class U> friend class ArenaAllocator;
+
+    Arena *arena;
+};
+
+// Вектор, размещаемый в арене текущего потока
+template <class T> using arena_vector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,238 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../Models/Move.h"
+#include "Rules.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define BATCH_EVAL_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BATCH_EVAL_AVX2
+#else
+#include <immintrin.h>
+#define BATCH_EVAL_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Пакетный подсчет материала для оценки листьев поиска
+// Позиция упаковывается в четыре 32-битные маски (белые шашки, черные шашки, белые дамки,
+// черные дамки) по 32 черным клеткам: клетка (i, j) - бит i * 4 + j / 2, то есть каждая
+// строка доски - это 4 бита. Тогда число фигур - это сумма popcount по маскам, а сумма
+// номеров строк шашек (их близость к превращению) - сумма popcount полубайтов с весами строк.
+// Для пакета позиций подсчет выполняется командами AVX2 (по две позиции на регистр),
+// если процессор их поддерживает, иначе - обычным кодом с тем же результатом
+// Параметр Rules - вариант правил (см. Rules.h): на доске 10x10 маски 64-битные, строка - 5 бит,
+// подсчет выполняется только обычным кодом
+template <class Rules> class BasicBatchEval
+{
+    typedef typename Rules::Bits Bits;
+
+  public:
+    // Упакованная позиция: маски шашек и дамок, индекс 0 - белые, 1 - черные
+    struct Packed
+    {
+        Bits men[2] = {0, 0};
+        Bits kings[2] = {0, 0};
+    };
+
+    // Материал позиции: индекс 0 - белые, 1 - черные
+    struct Material
+    {
+        int men[2];    // Число простых шашек
+        int rows[2];   // Сумма продвижения шашек (на сколько строк шашка прошла от своего края)
+        int kings[2];  // Число дамок
+    };
+
+    // Номер бита клетки (i, j) в маске
+    static int bit(const POS_T i, const POS_T j)
+    {
+        return Rules::square(i, j);
+    }
+
+    // Упаковка доски в маски
+    static Packed pack(const std::vector<std::vector<POS_T>> &mtx)
+    {
+        Packed res;
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
+        {
+            for (POS_T j = (i + 1) % 2; j < Rules::SIZE; j += 2)
+            {
+                const POS_T type = mtx[i][j];
+                if (type)
+                    put(res, type, bit(i, j));
+            }
+        }
+        return res;
+    }
+
+    // Добавление фигуры типа type (1-4, как на доске) в бит b
+    static void put(Packed &pos, const POS_T type, const int b)
+    {
+        Bits &mask = type <= 2 ? pos.men[type - 1] : pos.kings[type - 3];
+        mask |= Bits(1) << b;
+    }
+
+    // Удаление фигуры типа type из бита b
+    static void remove(Packed &pos, const POS_T type, const int b)
+    {
+        Bits &mask = type <= 2 ? pos.men[type - 1] : pos.kings[type - 3];
+        mask &= ~(Bits(1) << b);
+    }
+
+    // Упакованная позиция после полного хода chain
+    // Параметры:
+    // parent - упакованная позиция до хода
+    // mtx - доска до хода
+    // chain - полный ход
+    // final_type - тип фигуры в конце хода (с учетом превращения)
+    template <class Chain>
+    static Packed after(Packed parent, const std::vector<std::vector<POS_T>> &mtx, const Chain &chain,
+                        const POS_T final_type)
+    {
+        remove(parent, mtx[chain.x()][chain.y()], bit(chain.x(), chain.y()));
+        for (const auto &cell : chain.captured)
+            remove(parent, mtx[cell.first][cell.second], bit(cell.first, cell.second));
+        put(parent, final_type, bit(chain.x2(), chain.y2()));
+        return parent;
+    }
+
+    // Подсчет материала для n позиций
+    static void count(const Packed *positions, const size_t n, Material *out)
+    {
+        size_t done = 0;
+#ifdef BATCH_EVAL_X86
+        if constexpr (Rules::SIZE == 8)
+        {
+            if (use_avx2())
+                done = count_avx2(positions, n, out);
+        }
+#endif
+        for (size_t i = done; i < n; ++i)
+            out[i] = count_scalar(positions[i]);
+    }
+
+    // Подсчет материала одной позиции без SIMD (по строкам, как и в варианте AVX2)
+    static Material count_scalar(const Packed &pos)
+    {
+        static const auto row_counts = make_row_counts();
+        const Bits row_mask = (Bits(1) << Rules::HALF) - 1;
+        Material res{{0, 0}, {0, 0}, {0, 0}};
+        for (int row = 0; row < Rules::SIZE; ++row)
+        {
+            const int shift = row * Rules::HALF;
+            const int white = row_counts[(pos.men[0] >> shift) & row_mask];
+            const int black = row_counts[(pos.men[1] >> shift) & row_mask];
+            res.men[0] += white;
+            res.men[1] += black;
+            res.rows[0] += white * (Rules::LAST - row);
+            res.rows[1] += black * row;
+            res.kings[0] += row_counts[(pos.kings[0] >> shift) & row_mask];
+            res.kings[1] += row_counts[(pos.kings[1] >> shift) & row_mask];
+        }
+        return res;
+    }
+
+    // Используются ли команды AVX2 (определяется по процессору при первом вызове,
+    // может быть отключено через set_avx2 для сравнения)
+    static bool use_avx2()
+    {
+        return avx2_flag();
+    }
+
+    static void set_avx2(const bool enabled)
+    {
+        avx2_flag() = enabled && cpu_has_avx2();
+    }
+
+    // Поддерживает ли процессор AVX2
+    static bool cpu_has_avx2()
+    {
+#if defined(BATCH_EVAL_X86) && defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        if (regs[0] < 7)
+            return false;
+        __cpuid(regs, 1);
+        // Операционная система должна сохранять регистры YMM (OSXSAVE и XCR0)
+        if (!(regs[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#elif defined(BATCH_EVAL_X86)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+
+  private:
+    // Число фигур для каждого значения строки маски (для 8x8 - полубайта)
+    static std::array<int, (1 << Rules::HALF)> make_row_counts()
+    {
+        std::array<int, (1 << Rules::HALF)> res{};
+        for (size_t v = 1; v < res.size(); ++v)
+            res[v] = res[v >> 1] + int(v & 1);
+        return res;
+    }
+
+    static bool &avx2_flag()
+    {
+        static bool flag = cpu_has_avx2();
+        return flag;
+    }
+
+#ifdef BATCH_EVAL_X86
+    // Подсчет материала командами AVX2 по две позиции за шаг
+    // Каждый байт маски - две строки доски (младший полубайт - четная строка), поэтому
+    // popcount полубайтов (через таблицу в регистре) сразу дает число фигур в строках.
+    // Суммы по маскам с весами 1 дают число фигур, а с весами строк - продвижение шашек
+    // Возвращает число обработанных позиций (четное)
+    BATCH_EVAL_AVX2 static size_t count_avx2(const Packed *positions, const size_t n, Material *out)
+    {
+        static_assert(sizeof(Packed) == 16, "Packed must be four 32-bit masks");
+        const __m256i nibble_counts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1,
+                                                       2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_mask = _mm256_set1_epi8(0x0F);
+        const __m256i ones8 = _mm256_set1_epi8(1);
+        const __m256i ones16 = _mm256_set1_epi16(1);
+        // Веса строк для байта k маски: младший полубайт - строка 2k, старший - строка 2k+1
+        // Белые шашки продвигаются к строке 0 (вес 7 - строка), черные - к строке 7 (вес - строка)
+        const __m256i low_weights = _mm256_setr_epi8(7, 5, 3, 1, 0, 2, 4, 6, 0, 0, 0, 0, 0, 0, 0, 0, 7, 5, 3, 1, 0,
+                                                     2, 4, 6, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i high_weights = _mm256_setr_epi8(6, 4, 2, 0, 1, 3, 5, 7, 0, 0, 0, 0, 0, 0, 0, 0, 6, 4, 2, 0,
+                                                      1, 3, 5, 7, 0, 0, 0, 0, 0, 0, 0, 0);
+        alignas(32) int32_t counts[8], rows[8];
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2)
+        {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(positions + i));
+            const __m256i low = _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(v, low_mask));
+            const __m256i high =
+                _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask));
+            const __m256i cnt16 = _mm256_add_epi16(_mm256_maddubs_epi16(low, ones8), _mm256_maddubs_epi16(high, ones8));
+            const __m256i row16 = _mm256_add_epi16(_mm256_maddubs_epi16(low, low_weights),
+                                                   _mm256_maddubs_epi16(high, high_weights));
+            // Суммы по 4 байтам: по одному числу на каждую маску (шашки и дамки белых и черных)
+            _mm256_store_si256(reinterpret_cast<__m256i *>(counts), _mm256_madd_epi16(cnt16, ones16));
+            _mm256_store_si256(reinterpret_cast<__m256i *>(rows), _mm256_madd_epi16(row16, ones16));
+            for (int k = 0; k < 2; ++k)
+            {
+                Material &m = out[i + k];
+                m.men[0] = counts[4 * k];
+                m.men[1] = counts[4 * k + 1];
+                m.kings[0] = counts[4 * k + 2];
+                m.kings[1] = counts[4 * k + 3];
+                m.rows[0] = rows[4 * k];
+                m.rows[1] = rows[4 * k + 1];
+            }
+        }
+        return i;
+    }
+#endif
+};
+
+typedef BasicBatchEval<RussianRules> BatchEval;
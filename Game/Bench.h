@@ -0,0 +1,210 @@
+#pragma once
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "Logic.h"
+#include "Options.h"
+
+// Детерминированный тест производительности бота (режим "bench")
+// Ищет лучший ход в наборе из 50 фиксированных позиций на заданную глубину
+// с детерминированным порядком ходов и выводит число рассмотренных позиций,
+// контрольную сумму и скорость поиска. Одинаковые число позиций и контрольная сумма
+// означают, что изменение не повлияло на работу поиска
+class Bench
+{
+  public:
+    // Запуск теста
+    // Параметры командной строки: [глубина] [уровень оптимизации] [размер таблицы транспозиций в МБ]
+    // [оценка листьев] [режим оценки позиции], например "bench 7 O2 16 scalar" (по умолчанию таблица
+    // транспозиций не используется, режим оценки - "NumberAndPotential")
+    // Оценка листьев: "batch" - пакетная (AVX2, если поддерживается процессором), "portable" - пакетная
+    // без AVX2, "scalar" - каждый лист отдельно через calc_score; результат поиска от нее не зависит
+    // Режим оценки "NNUE" позволяет сравнить скорость нейросетевой оценки с материальной
+    // Таблица очищается перед каждой позицией, поэтому результаты не зависят от порядка позиций
+    // Возвращает 0 при успехе, 1 при ошибке в параметрах
+    int run(const int argc, char *argv[]) const
+    {
+        int depth = 7;
+        if (argc > 0 && !Options::parse_number(string(argv[0]), depth, 1, 64))
+        {
+            cerr << "bench: bad depth '" << argv[0] << "'" << endl << USAGE << endl;
+            return 1;
+        }
+        const string optimization = argc > 1 ? argv[1] : "O1";
+        size_t hash_mb = 0;
+        if (argc > 2 && !Options::parse_number(string(argv[2]), hash_mb, size_t(0), size_t(65536)))
+        {
+            cerr << "bench: bad hash size '" << argv[2] << "'" << endl << USAGE << endl;
+            return 1;
+        }
+        const string leaves = argc > 3 ? argv[3] : "batch";
+        const string scoring = argc > 4 ? argv[4] : "NumberAndPotential";
+        if (leaves != "batch" && leaves != "portable" && leaves != "scalar")
+        {
+            cerr << "bench: unknown leaf evaluation " << leaves << endl << USAGE << endl;
+            return 1;
+        }
+        BatchEval::set_avx2(leaves == "batch");
+
+        Config config(json{{"Bot", {{"NoRandom", true},
+                                    {"BotScoringType", scoring},
+                                    {"Optimization", optimization}}}});
+        // Неизвестные уровень оптимизации или режим оценки - ошибка параметров, а не аварийное завершение
+        unique_ptr<Logic> checked;
+        try
+        {
+            checked = make_unique<Logic>(nullptr, &config);
+        }
+        catch (const exception &e)
+        {
+            cerr << "bench: " << e.what() << endl << USAGE << endl;
+            return 1;
+        }
+        Logic &logic = *checked;
+        logic.Max_depth = depth;
+        logic.batch_leaves = (leaves != "scalar");
+        TransTable tt(hash_mb);
+        if (hash_mb)
+            logic.tt = &tt;
+
+        uint64_t total_nodes = 0;
+        uint64_t signature = 14695981039346656037ull;  // FNV-1a
+#ifndef NDEBUG
+        uint64_t search_allocations = 0;  // Выделения памяти в куче внутри поиска после прогрева
+#endif
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            const auto mtx = parse_position(positions[i].first);
+            const bool color = positions[i].second;
+            // Позиции независимы: знания прошлых поисков не переносятся
+            if (hash_mb)
+                tt.clear();
+            logic.new_game();
+#ifndef NDEBUG
+            const uint64_t allocations_before = Arena::heap_allocations();
+#endif
+            const auto turns = logic.find_best_turns(mtx, color);
+#ifndef NDEBUG
+            // Первая позиция прогревает арену поиска
+            if (i > 0)
+                search_allocations += Arena::heap_allocations() - allocations_before;
+#endif
+
+            total_nodes += logic.nodes;
+            signature = fnv(signature, logic.nodes);
+            signature = fnv(signature, uint64_t(int64_t(logic.last_score)));
+            for (const auto &turn : turns)
+                signature = fnv(signature, uint64_t(turn.x * 512 + turn.y * 64 + turn.x2 * 8 + turn.y2));
+
+            cout << "Position " << setw(2) << i + 1 << "/" << positions.size() << ": nodes " << setw(10)
+                 << logic.nodes << "  score " << setw(11) << logic.last_score << "\n";
+        }
+        auto end = chrono::steady_clock::now();
+        const double ms = max(1.0, chrono::duration<double, milli>(end - start).count());
+
+        cout << "===========================\n";
+        cout << "Depth           : " << depth << "\n";
+        cout << "Optimization    : " << optimization << "\n";
+        cout << "Hash (MB)       : " << hash_mb << "\n";
+        cout << "Scoring         : " << scoring << "\n";
+        cout << "Leaf evaluation : " << (leaves == "scalar" ? "scalar" : BatchEval::use_avx2() ? "batch (AVX2)" : "batch")
+             << "\n";
+        cout << "Total time (ms) : " << int64_t(ms) << "\n";
+        cout << "Nodes searched  : " << total_nodes << "\n";
+        cout << "Nodes/second    : " << uint64_t(total_nodes * 1000.0 / ms) << "\n";
+        cout << "Signature       : " << hex << signature << dec << endl;
+#ifndef NDEBUG
+        // Каждый поиск выделяет память под возвращаемый ход, остальное - обращения к куче из самого поиска
+        cout << "Heap allocations in search after warm-up: " << search_allocations << " ("
+             << positions.size() - 1 << " of them for returned moves)" << endl;
+#endif
+        return 0;
+    }
+
+    // Разбор позиции из строки из 32 символов (черные клетки по строкам сверху вниз):
+    // '.' - пусто, 'w' - белая шашка, 'b' - черная шашка, 'W' - белая дамка, 'B' - черная дамка
+    static vector<vector<POS_T>> parse_position(const string &cells)
+    {
+        vector<vector<POS_T>> mtx(8, vector<POS_T>(8, 0));
+        size_t k = 0;
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = (i + 1) % 2; j < 8; j += 2)
+            {
+                mtx[i][j] = POS_T(string(".wbWB").find(cells[k++]));
+            }
+        }
+        return mtx;
+    }
+
+  private:
+    static constexpr const char *USAGE =
+        "bench: usage: bench [depth 1..64] [O0..O4] [hash MB] [batch|portable|scalar] [scoring]";
+
+    // Шаг хеш-функции FNV-1a для 64-битного значения
+    static uint64_t fnv(uint64_t h, uint64_t value)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            h ^= (value >> (8 * i)) & 0xFF;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    // Набор позиций: дебюты, миттельшпили и окончания с дамками; второй элемент - ход черных
+    const vector<pair<string, bool>> positions = {
+        {"bbbb.bbbbbbbb...ww...w.wwwwwwwww", false},
+        {".bbbbbbbbb.bb..bwww.ww...wwwwwww", false},
+        {".bbbbbbb.b.wb..ww..w....w..wwwww", false},
+        {"..bbb..bbbbbbb..bww...w.w.wwwwww", false},
+        {".....b..b...w...B..bW......b...w", false},
+        {"...b...bbbb.bw.b.w..ww.W.wwww.ww", false},
+        {"WW.....b..b.w..b.w....ww...w.www", false},
+        {"........W.bb..b....ww..wwBw.....", false},
+        {"....B....w.bw..b....w.....b..B..", false},
+        {".bbbbbbbbbbbw....bwww...wwwwwwww", false},
+        {"..bbbbbbb.bb.b...www.w....wwwwww", false},
+        {"b.bbwb.b.bbbw...wbwww..w....wwww", false},
+        {"......bbbbbbb..b..ww.bww....wwww", false},
+        {"....b.b.b.bbb..b...ww.B....w....", false},
+        {"..........b.wb....bwww......w.w.", false},
+        {"........w..Ww........ww........B", false},
+        {"......B....bb.wb.....bw....w....", false},
+        {"bbbbbbbb..bbb.b.ww...w.wwwwwwwww", false},
+        {"bb.bbbbb.bbbwb.bw....www.wwwwwww", false},
+        {"...bbb.bbbbbbbb...wbwwwwww.w....", false},
+        {"...W....w..b........w..w....B.ww", true},
+        {"........bbbb....w.w..w.......w.w", false},
+        {"bbbbbbbb.bb.b..bww...w.wwwwwwwww", false},
+        {".bbbbbbbbb.bb..bwww..ww.w.wwwwww", false},
+        {"..bbbbbbb.bbb...ww.www...bwwww.w", false},
+        {".b.bbbbbb...b...w.b.ww...w.wwwww", false},
+        {"W.W....b...b............w.w.w.ww", true},
+        {".b.b....b..bb..bW..bwwww..wwww..", false},
+        {"..W...b..b..b..w....ww...wBww...", false},
+        {"......b....Wb.b.....bww..ww...w.", false},
+        {"...b.B.b...b.Wbw....w..b......B.", false},
+        {"bbbb.bbbbbbbb....w.ww.w.wwwwwwww", false},
+        {"..bbb.bbbbbbbwbb.w.wwwwww..ww.ww", false},
+        {"..bb..bbb..bb....w.b..w.wwwwwwww", false},
+        {"..bb.bbb.b.b.bw...w......b.wwwww", false},
+        {"...bb..bbb.wb.b...bwB..w.w.w....", false},
+        {".W..b.....b.b.......w.w.bw...w.w", false},
+        {"b.bbbbbbbb.bw....w...ww.wwwwwwww", false},
+        {"W...............B......w.....w..", true},
+        {".bbb..bb..bb.bb.b..w...www.wwwww", false},
+        {"...bbb.bbbbbb...w.w.wwww.wwwww..", false},
+        {"..bbbb..b.bbw....w....b...www.w.", false},
+        {"....b....b.bbb.....bw...w....B.w", false},
+        {"....W..........b............B...", false},
+        {".bbb..bbbbbbb.....w.w....wwww.ww", false},
+        {"b..bw.bbwbbbb.b...b.ww.w..wwwwww", false},
+        {"...b...b...b......bb........Bw.B", false},
+        {"...bbb.bbbbbw.wb.wwbb.www.ww.w..", false},
+        {"...bb.bb.bbb...b.b.wwb.w...www..", false},
+        {".....b..b..Wb.b.w..www.......B..", true},
+    };
+};
@@ -0,0 +1,139 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Двоичные файлы данных (обучающие данные, архив партий): чтение через отображение в память
+// и дополнение файла, который состоит из заголовка и целых единиц данных подряд
+
+// Файл, отображенный в память только для чтения (на Windows читается целиком)
+class MappedFile
+{
+  public:
+    // Параметр what - название файла для сообщений об ошибках
+    // Бросает runtime_error, если файл не открывается
+    MappedFile(const std::string &path, const std::string &what)
+    {
+#ifndef _WIN32
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("can't open " + what + " '" + path + "'");
+        // Отображение остается действительным после закрытия файла
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *mapped = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error("can't map " + what + " '" + path + "'");
+            }
+            data = static_cast<const char *>(mapped);
+            bytes = size_t(st.st_size);
+        }
+        close(fd);
+#else
+        std::ifstream fin(path, std::ios::binary);
+        if (!fin)
+            throw std::runtime_error("can't open " + what + " '" + path + "'");
+        buffer.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+        bytes = buffer.size();
+        data = buffer.data();
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (data)
+            munmap(const_cast<char *>(data), bytes);
+#endif
+    }
+
+    const char *data = nullptr;
+    size_t bytes = 0;
+
+  private:
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+};
+
+// Файл, который только дополняется: заголовок и целые единицы данных (записи, партии) подряд
+// При открытии недописанная последняя единица (если запись прервалась) отрезается, чтобы новые
+// данные начинались с ее границы, а не продолжали ее; пустой или новый файл получает заголовок
+// Запись не синхронизирована: блокировку при записи из нескольких потоков делает владелец
+class AppendFile
+{
+  public:
+    // Параметры:
+    // what - название файла для сообщений об ошибках
+    // header - заголовок нового файла
+    // check - проверка заголовка существующего файла (бросает runtime_error при несовпадении формата)
+    // complete - размер начала файла из заголовка и целых единиц данных (по содержимому и размеру файла)
+    // Бросает runtime_error, если файл не открывается или имеет другой формат
+    AppendFile(const std::string &path, const std::string &what, const std::string &header,
+               const std::function<void(const char *)> &check,
+               const std::function<size_t(const char *, size_t)> &complete)
+        : path(path), what(what)
+    {
+        std::error_code ec;
+        if (std::filesystem::exists(path, ec))
+        {
+            size_t bytes, keep;
+            {
+                MappedFile file(path, what);
+                bytes = keep = file.bytes;
+                if (bytes > 0 && bytes < header.size())
+                    throw std::runtime_error("truncated " + what + " header in '" + path + "'");
+                if (bytes > 0)
+                {
+                    check(file.data);
+                    keep = complete(file.data, bytes);
+                }
+            }
+            if (keep < bytes)
+                std::filesystem::resize_file(path, keep, ec);
+            if (ec)
+                throw std::runtime_error("can't truncate " + what + " '" + path + "': " + ec.message());
+        }
+        fout.open(path, std::ios::binary | std::ios::app);
+        if (!fout)
+            throw std::runtime_error("can't open " + what + " '" + path + "'");
+        if (fout.tellp() == std::streampos(0))
+            fout.write(header.data(), header.size());
+    }
+
+    // Добавление данных (на диск попадают при flush)
+    void write(const void *data, const size_t size)
+    {
+        fout.write(static_cast<const char *>(data), size);
+    }
+
+    // Сброс добавленных данных на диск, бросает runtime_error при ошибке записи
+    void flush()
+    {
+        fout.flush();
+        if (!fout)
+            throw std::runtime_error("can't write " + what + " '" + path + "'");
+    }
+
+  private:
+    std::string path;
+    std::string what;
+    std::ofstream fout;
+};
@@ -1,10 +1,13 @@
 #pragma once
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <vector>
 
 #include "../Models/Move.h"
 #include "../Models/Project_path.h"
+#include "Rules.h"
+#include "Textures.h"
 
 // Условная компиляция для разных операционных систем
 #ifdef __APPLE__
@@ -21,6 +24,11 @@ using namespace std;
 class Board
 {
 public:
+    // Вариант правил, для которого нарисована доска (Textures/board.png - доска 8x8)
+    typedef RussianRules Rules;
+    // Число клеток окна по каждой стороне: доска и рамка шириной в одну клетку
+    static const int CELLS = Rules::SIZE + 2;
+
     Board() = default;
     // Конструктор с заданными размерами окна
     Board(const unsigned int W, const unsigned int H) : W(W), H(H)
@@ -31,10 +39,16 @@ public:
     // Возвращает 0 при успехе, 1 при ошибке
     int start_draw()
     {
-        // Инициализация SDL
-        if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
+        // Инициализация SDL: нужны только окно, рендерер и события (подсистема видео),
+        // остальные подсистемы (звук, джойстики, датчики) не запускаются
+        if (SDL_Init(SDL_INIT_VIDEO) != 0)
+        {
+            print_exception("SDL_Init can't init SDL2 video subsystem");
+            return 1;
+        }
+        if ((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0)
         {
-            print_exception("SDL_Init can't init SDL2 lib");
+            print_exception("IMG_Init can't init PNG loader");
             return 1;
         }
 
@@ -68,19 +82,22 @@ public:
             return 1;
         }
 
-        // Загрузка текстур
-        board = IMG_LoadTexture(ren, board_path.c_str());
-        w_piece = IMG_LoadTexture(ren, piece_white_path.c_str());
-        b_piece = IMG_LoadTexture(ren, piece_black_path.c_str());
-        w_queen = IMG_LoadTexture(ren, queen_white_path.c_str());
-        b_queen = IMG_LoadTexture(ren, queen_black_path.c_str());
-        back = IMG_LoadTexture(ren, back_path.c_str());
-        replay = IMG_LoadTexture(ren, replay_path.c_str());
-        if (!board || !w_piece || !b_piece || !w_queen || !b_queen || !back || !replay)
+        // Загрузка всех текстур в атлас (один раз за запуск, включая картинки итога партии)
+        auto textures_start = chrono::steady_clock::now();
+        if (!textures.load(ren, textures_path))
         {
-            print_exception("IMG_LoadTexture can't load main textures from " + textures_path);
+            print_exception("TextureAtlas can't load textures from " + textures_path);
             return 1;
         }
+        for (const string &name : texture_names)
+        {
+            if (!textures.has(name))
+            {
+                print_exception("TextureAtlas has no texture " + textures_path + name + ".png");
+                return 1;
+            }
+        }
+        textures_ms = (int)chrono::duration<double, milli>(chrono::steady_clock::now() - textures_start).count();
 
         // Получение реальных размеров окна
         SDL_GetRendererOutputSize(ren, &W, &H);
@@ -98,6 +115,7 @@ public:
         history_mtx.clear();  // Очистка истории ходов
         history_beat_series.clear();  // Очистка истории серий взятий
         make_start_mtx();  // Создание начальной расстановки
+        hint_cells.clear();  // Очистка подсказки
         clear_active();  // Очистка активной шашки
         clear_highlight();  // Очистка подсветки
     }
@@ -154,6 +172,20 @@ public:
         return mtx;
     }
 
+    // Возвращает историю позиций после полных ходов (без промежуточных позиций серий взятий)
+    // Первая позиция - начальная расстановка, ход в позиции с индексом i делают черные, если i нечетно
+    vector<vector<vector<POS_T>>> move_history() const
+    {
+        vector<vector<vector<POS_T>>> res;
+        for (size_t i = 0; i < history_mtx.size(); ++i)
+        {
+            // Позиция завершает ход, если следующая запись начинает новый ход
+            if (i + 1 == history_mtx.size() || history_beat_series[i + 1] <= 1)
+                res.push_back(history_mtx[i]);
+        }
+        return res;
+    }
+
     // Подсветка клеток
     void highlight_cells(vector<pair<POS_T, POS_T>> cells)
     {
@@ -168,13 +200,36 @@ public:
     // Удаление подсветки
     void clear_highlight()
     {
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
         {
-            is_highlighted_[i].assign(8, 0);  // Удаление подсветки
+            is_highlighted_[i].assign(Rules::SIZE, 0);  // Удаление подсветки
         }
         rerender();  // Перерисовка доски
     }
 
+    // Подсветка подсказки - клеток лучшего хода - другим цветом, чем подсветка возможных ходов
+    // (пустой список убирает подсказку)
+    void highlight_hint(const vector<pair<POS_T, POS_T>> &cells)
+    {
+        hint_cells = cells;
+        rerender();  // Перерисовка доски
+    }
+
+    // Удаление подсказки
+    void clear_hint()
+    {
+        if (hint_cells.empty())
+            return;
+        hint_cells.clear();
+        rerender();  // Перерисовка доски
+    }
+
+    // Заголовок окна
+    void set_title(const string &title)
+    {
+        SDL_SetWindowTitle(win, title.c_str());
+    }
+
     // Установка активной шашки
     void set_active(const POS_T x, const POS_T y)
     {
@@ -228,15 +283,11 @@ public:
     // Выход из игры
     void quit()
     {
-        SDL_DestroyTexture(board);  // Удаление текстур
-        SDL_DestroyTexture(w_piece);
-        SDL_DestroyTexture(b_piece);
-        SDL_DestroyTexture(w_queen);
-        SDL_DestroyTexture(b_queen);
-        SDL_DestroyTexture(back);
-        SDL_DestroyTexture(replay);
+        textures.clear();  // Удаление текстур
         SDL_DestroyRenderer(ren);  // Удаление рендерера
         SDL_DestroyWindow(win);  // Удаление окна
+        win = nullptr;
+        IMG_Quit();
         SDL_Quit();  // Выход из SDL
     }
 
@@ -258,20 +309,29 @@ private:
     // Создание начальной расстановки шашек
     void make_start_mtx()
     {
-        for (POS_T i = 0; i < 8; ++i)
+        mtx = start_mtx();
+        add_history();  // Добавление начальной расстановки в историю
+    }
+
+public:
+    // Возвращает начальную расстановку шашек варианта Variant (по умолчанию - варианта доски)
+    template <class Variant = Rules> static vector<vector<POS_T>> start_mtx()
+    {
+        vector<vector<POS_T>> res(Variant::SIZE, vector<POS_T>(Variant::SIZE, 0));
+        for (POS_T i = 0; i < Variant::SIZE; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < Variant::SIZE; ++j)
             {
-                mtx[i][j] = 0;  // Очистка доски
-                if (i < 3 && (i + j) % 2 == 1)  // Расстановка белых шашек
-                    mtx[i][j] = 2;
-                if (i > 4 && (i + j) % 2 == 1)  // Расстановка черных шашек
-                    mtx[i][j] = 1;
+                if (i < Variant::START_ROWS && (i + j) % 2 == 1)  // Расстановка черных шашек
+                    res[i][j] = 2;
+                if (i >= Variant::SIZE - Variant::START_ROWS && (i + j) % 2 == 1)  // Расстановка белых шашек
+                    res[i][j] = 1;
             }
         }
-        add_history();  // Добавление начальной расстановки в историю
+        return res;
     }
 
+private:
     // Перерисовка доски
     void rerender()
     {
@@ -279,30 +339,23 @@ private:
         SDL_RenderClear(ren);
 
         // Рисование доски
-        SDL_RenderCopy(ren, board, NULL, NULL);
+        textures.draw(ren, "board", NULL);
 
         // Рисование шашек
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
             {
                 if (!mtx[i][j])  // Если клетка пуста
                     continue;
-                int wpos = W * (j + 1) / 10 + W / 120;  // Вычисление координаты шашки
-                int hpos = H * (i + 1) / 10 + H / 120;
-                SDL_Rect rect{ wpos, hpos, W / 12, H / 12 };
-
-                SDL_Texture* piece_texture;  // Выбор текстуры шашки
-                if (mtx[i][j] == 1)
-                    piece_texture = w_piece;
-                else if (mtx[i][j] == 2)
-                    piece_texture = b_piece;
-                else if (mtx[i][j] == 3)
-                    piece_texture = w_queen;
-                else
-                    piece_texture = b_queen;
-
-                SDL_RenderCopy(ren, piece_texture, NULL, &rect);  // Рисование шашки
+                // Шашка занимает 5/6 клетки и стоит в ее центре
+                int wpos = W * (j + 1) / CELLS + W / (12 * CELLS);  // Вычисление координаты шашки
+                int hpos = H * (i + 1) / CELLS + H / (12 * CELLS);
+                SDL_Rect rect{ wpos, hpos, W * 5 / (6 * CELLS), H * 5 / (6 * CELLS) };
+
+                const string &piece_texture = piece_names[mtx[i][j] - 1];  // Выбор текстуры шашки
+
+                textures.draw(ren, piece_texture, &rect);  // Рисование шашки
             }
         }
 
@@ -310,54 +363,66 @@ private:
         SDL_SetRenderDrawColor(ren, 0, 255, 0, 0);
         const double scale = 2.5;
         SDL_RenderSetScale(ren, scale, scale);
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
             {
                 if (!is_highlighted_[i][j])  // Если клетка не подсвечена
                     continue;
-                SDL_Rect cell{ int(W * (j + 1) / 10 / scale), int(H * (i + 1) / 10 / scale), int(W / 10 / scale),
-                              int(H / 10 / scale) };
+                SDL_Rect cell{ int(W * (j + 1) / CELLS / scale), int(H * (i + 1) / CELLS / scale),
+                              int(W / CELLS / scale), int(H / CELLS / scale) };
                 SDL_RenderDrawRect(ren, &cell);  // Рисование подсветки
             }
         }
 
+        // Рисование подсказки: рамка внутри клетки, чтобы она была видна и поверх подсветки
+        SDL_SetRenderDrawColor(ren, 0, 128, 255, 0);
+        for (const auto &hint : hint_cells)
+        {
+            SDL_Rect cell{ int(W * (hint.second + 1) / CELLS / scale) + 2, int(H * (hint.first + 1) / CELLS / scale) + 2,
+                          int(W / CELLS / scale) - 4, int(H / CELLS / scale) - 4 };
+            SDL_RenderDrawRect(ren, &cell);  // Рисование подсказки
+        }
+
         // Рисование активной шашки
         if (active_x != -1)
         {
             SDL_SetRenderDrawColor(ren, 255, 0, 0, 0);
-            SDL_Rect active_cell{ int(W * (active_y + 1) / 10 / scale), int(H * (active_x + 1) / 10 / scale),
-                                 int(W / 10 / scale), int(H / 10 / scale) };
+            SDL_Rect active_cell{ int(W * (active_y + 1) / CELLS / scale), int(H * (active_x + 1) / CELLS / scale),
+                                 int(W / CELLS / scale), int(H / CELLS / scale) };
             SDL_RenderDrawRect(ren, &active_cell);  // Рисование активной шашки
         }
         SDL_RenderSetScale(ren, 1, 1);
 
         // Рисование кнопок
         SDL_Rect rect_left{ W / 40, H / 40, W / 15, H / 15 };
-        SDL_RenderCopy(ren, back, NULL, &rect_left);
+        textures.draw(ren, "back", &rect_left);
         SDL_Rect replay_rect{ W * 109 / 120, H / 40, W / 15, H / 15 };
-        SDL_RenderCopy(ren, replay, NULL, &replay_rect);
+        textures.draw(ren, "replay", &replay_rect);
 
         // Рисование результата игры
         if (game_results != -1)
         {
-            string result_path = draw_path;
+            // Картинка итога уже в атласе, кадры после конца партии не читают файлы
+            string result_texture = "draw";
             if (game_results == 1)
-                result_path = white_path;
+                result_texture = "white_wins";
             else if (game_results == 2)
-                result_path = black_path;
-            SDL_Texture* result_texture = IMG_LoadTexture(ren, result_path.c_str());
-            if (result_texture == nullptr)
-            {
-                print_exception("IMG_LoadTexture can't load game result picture from " + result_path);
-                return;
-            }
+                result_texture = "black_wins";
             SDL_Rect res_rect{ W / 5, H * 3 / 10, W * 3 / 5, H * 2 / 5 };
-            SDL_RenderCopy(ren, result_texture, NULL, &res_rect);
-            SDL_DestroyTexture(result_texture);
+            textures.draw(ren, result_texture, &res_rect);
         }
 
         SDL_RenderPresent(ren);  // Обновление экрана
+        if (!startup_reported)  // Время от создания доски до первого кадра
+        {
+            startup_reported = true;
+            ofstream fout(project_path + "log.txt", ios_base::app);
+            fout << "Startup time: "
+                 << (int)chrono::duration<double, milli>(chrono::steady_clock::now() - created).count()
+                 << " millisec, textures " << textures_ms << " millisec, " << textures.pages_count()
+                 << " atlas pages\n";
+        }
         // next rows for mac os
         SDL_Delay(10);
         SDL_Event windowEvent;
@@ -380,35 +445,29 @@ public:
 private:
     SDL_Window *win = nullptr;  // Окно
     SDL_Renderer *ren = nullptr;  // Рендерер
-    // Текстуры
-    SDL_Texture *board = nullptr;
-    SDL_Texture *w_piece = nullptr;
-    SDL_Texture *b_piece = nullptr;
-    SDL_Texture *w_queen = nullptr;
-    SDL_Texture *b_queen = nullptr;
-    SDL_Texture *back = nullptr;
-    SDL_Texture *replay = nullptr;
-    // Пути к текстурам
+    // Текстуры (все изображения из textures_path, загружаются один раз при запуске)
+    TextureAtlas textures;
     const string textures_path = project_path + "Textures/";
-    const string board_path = textures_path + "board.png";
-    const string piece_white_path = textures_path + "piece_white.png";
-    const string piece_black_path = textures_path + "piece_black.png";
-    const string queen_white_path = textures_path + "queen_white.png";
-    const string queen_black_path = textures_path + "queen_black.png";
-    const string white_path = textures_path + "white_wins.png";
-    const string black_path = textures_path + "black_wins.png";
-    const string draw_path = textures_path + "draw.png";
-    const string back_path = textures_path + "back.png";
-    const string replay_path = textures_path + "replay.png";
+    // Текстуры шашек по коду клетки 1-4
+    const vector<string> piece_names = {"piece_white", "piece_black", "queen_white", "queen_black"};
+    // Текстуры, без которых доска не рисуется
+    const vector<string> texture_names = {"board", "piece_white", "piece_black", "queen_white", "queen_black",
+                                          "back", "replay", "white_wins", "black_wins", "draw"};
+    // Время создания доски и загрузки текстур для отчета о запуске
+    const chrono::steady_clock::time_point created = chrono::steady_clock::now();
+    int textures_ms = 0;
+    bool startup_reported = false;
     // Координаты активной шашки
     int active_x = -1;
     int active_y = -1;
     // Результат игры
     int game_results = -1;
     // Матрица подсветки
-    vector<vector<bool>> is_highlighted_ = vector<vector<bool>>(8, vector<bool>(8, 0));
+    vector<vector<bool>> is_highlighted_ = vector<vector<bool>>(Rules::SIZE, vector<bool>(Rules::SIZE, 0));
+    // Клетки подсказки (лучшего хода)
+    vector<pair<POS_T, POS_T>> hint_cells;
     // Матрица доски
-    vector<vector<POS_T>> mtx = vector<vector<POS_T>>(8, vector<POS_T>(8, 0));
+    vector<vector<POS_T>> mtx = vector<vector<POS_T>>(Rules::SIZE, vector<POS_T>(Rules::SIZE, 0));
     // История серий взятий
     vector<int> history_beat_series;
 };
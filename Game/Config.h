@@ -13,12 +13,19 @@ class Config
         reload();
     }
 
+    // Конструктор с готовыми настройками (без чтения settings.json)
+    // Используется консольными режимами, которым нужны фиксированные настройки
+    explicit Config(json config) : config(std::move(config))
+    {
+    }
+
     // Функция reload() перезагружает настройки из файла settings.json
     // Это позволяет обновлять настройки игры без перезапуска программы
     void reload()
     {
         std::ifstream fin(project_path + "settings.json");
-        fin >> config;
+        // settings.json содержит комментарии, поэтому разбираем его с их пропуском
+        config = json::parse(fin, nullptr, true, true);
         fin.close();
     }
 
@@ -30,6 +37,15 @@ class Config
         return config[setting_dir][setting_name];
     }
 
+    // Значение настройки или default_value, если настройки нет в файле
+    // Используется для необязательных настроек, появившихся позже остальных
+    json value(const string &setting_dir, const string &setting_name, const json &default_value) const
+    {
+        if (!config.contains(setting_dir) || !config[setting_dir].contains(setting_name))
+            return default_value;
+        return config[setting_dir][setting_name];
+    }
+
   private:
     json config;  // JSON-объект, хранящий все настройки игры
 };
@@ -0,0 +1,169 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+#include "Arena.h"
+
+// Сопрограмма со своим стеком: функция, которая может приостановиться (yield) на любой глубине
+// вложенных вызовов и продолжиться с того же места при следующем resume. Так поиск хода
+// останавливается посреди итерации углубления без разбора рекурсии на части (см. Scheduler.h)
+// POSIX - ucontext, Windows - волокна (fibers)
+//
+// Продолжать сопрограмму можно в другом потоке. Единственное состояние потока, которым пользуется
+// поиск, - арена потока (Arena::current), поэтому она переключается вместе со стеком: внутри
+// сопрограммы действует арена, привязанная в ней, снаружи - арена вызывающего потока
+// Функция должна закончиться до уничтожения сопрограммы: деструкторы объектов на ее стеке
+// иначе не выполняются
+class Coroutine
+{
+  public:
+    // Параметры:
+    // body - функция сопрограммы (исключение из нее бросает resume)
+    // stack_size - размер стека в байтах (память выделяется по мере использования)
+    // Под стеком - защитная страница без доступа: переполнение стека завершает программу сигналом,
+    // а не портит чужую память (на Windows такую страницу создает CreateFiber)
+    explicit Coroutine(std::function<void()> body, const size_t stack_size = 1024 * 1024) : body(std::move(body))
+    {
+#ifdef _WIN32
+        fiber = CreateFiber(stack_size, &Coroutine::entry, this);
+        if (!fiber)
+            throw std::bad_alloc();
+#else
+        const size_t page = size_t(sysconf(_SC_PAGESIZE));
+        stack_bytes = (stack_size + page - 1) / page * page + page;
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_STACK
+        flags |= MAP_STACK;
+#endif
+        void *mapped = mmap(nullptr, stack_bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (mapped == MAP_FAILED)
+            throw std::bad_alloc();
+        stack = static_cast<char *>(mapped);
+        // Стек растет вниз, поэтому защитная страница - в начале отображения
+        if (mprotect(stack, page, PROT_NONE) != 0)
+        {
+            munmap(stack, stack_bytes);
+            throw std::bad_alloc();
+        }
+        getcontext(&inner);
+        inner.uc_stack.ss_sp = stack + page;
+        inner.uc_stack.ss_size = stack_bytes - page;
+        inner.uc_link = nullptr;
+        // makecontext передает только аргументы int: указатель делится на две половины
+        const uintptr_t self = reinterpret_cast<uintptr_t>(this);
+        makecontext(&inner, reinterpret_cast<void (*)()>(&Coroutine::entry), 2, unsigned(uint64_t(self) >> 32),
+                    unsigned(self & 0xFFFFFFFFu));
+#endif
+    }
+
+    Coroutine(const Coroutine &) = delete;
+    Coroutine &operator=(const Coroutine &) = delete;
+
+    ~Coroutine()
+    {
+#ifdef _WIN32
+        DeleteFiber(fiber);
+#else
+        munmap(stack, stack_bytes);
+#endif
+    }
+
+    // Выполнение функции до следующего yield или до ее окончания
+    // Возвращает true, если функция закончилась
+    bool resume()
+    {
+        Arena *&current = Arena::current();
+        Arena *const caller_arena = current;
+        current = arena;
+#ifdef _WIN32
+        if (!IsThreadAFiber())
+            ConvertThreadToFiber(nullptr);
+        outer = GetCurrentFiber();
+        SwitchToFiber(fiber);
+#else
+        swapcontext(&outer, &inner);
+#endif
+        Arena *&resumed = Arena::current();
+        arena = resumed;
+        resumed = caller_arena;
+        if (error)
+            std::rethrow_exception(std::exchange(error, nullptr));
+        return finished;
+    }
+
+    // Приостановка: возврат из resume. Вызывается только внутри функции сопрограммы
+    void yield()
+    {
+#ifdef _WIN32
+        SwitchToFiber(outer);
+#else
+        swapcontext(&inner, &outer);
+#endif
+    }
+
+    // Функция закончилась
+    bool done() const
+    {
+        return finished;
+    }
+
+  private:
+#ifdef _WIN32
+    static void WINAPI entry(void *self)
+    {
+        static_cast<Coroutine *>(self)->run();
+    }
+#else
+    static void entry(const unsigned high, const unsigned low)
+    {
+        reinterpret_cast<Coroutine *>(uintptr_t((uint64_t(high) << 32) | low))->run();
+    }
+#endif
+
+    // Выполнение функции на стеке сопрограммы; после нее управление больше сюда не возвращается
+    void run()
+    {
+        try
+        {
+            body();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        finished = true;
+        yield();
+    }
+
+    std::function<void()> body;
+    bool finished = false;
+    std::exception_ptr error;
+    Arena *arena = nullptr;  // Арена потока внутри сопрограммы между resume
+#ifdef _WIN32
+    void *fiber = nullptr;
+    void *outer = nullptr;
+#else
+    char *stack = nullptr;   // Отображение стека вместе с защитной страницей
+    size_t stack_bytes = 0;  // Размер отображения
+    ucontext_t inner;
+    ucontext_t outer;
+#endif
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "../Models/Difficulty.h"
+#include "../Models/Search.h"
+#include "Board.h"
+#include "Config.h"
+
+// Уровни сложности бота
+// Уровень в settings.json (WhiteBotLevel, BlackBotLevel) задается числом - номером готового
+// профиля (раньше число было глубиной поиска, и профиль N не ищет глубже N), или объектом
+// {"Depth": D, "Nodes": N, "TimeMS": T, "Noise": A} с явными ограничениями
+class Difficulty
+{
+  public:
+    // Готовый профиль уровня level
+    // Уровни 0-5 слабее за счет случайной добавки к оценке, уровни выше 5 ищут на глубину level
+    // с общими ограничениями числа позиций и времени
+    static difficulty_profile level(const int level)
+    {
+        static const difficulty_profile levels[] = {
+            {1, 2000, 50, 400},       // 0: почти случайные ходы с учетом взятий
+            {1, 5000, 100, 250},      // 1
+            {2, 20000, 150, 150},     // 2
+            {3, 60000, 250, 80},      // 3
+            {4, 200000, 400, 30},     // 4
+            {5, 600000, 700, 0},      // 5
+        };
+        if (level < 0)
+            throw std::runtime_error("bad bot level " + std::to_string(level));
+        if (level < int(sizeof(levels) / sizeof(levels[0])))
+            return levels[level];
+        return difficulty_profile{level, 2000000, 1500, 0};
+    }
+
+    // Профиль из настройки уровня: число (номер готового профиля) или объект с ограничениями
+    // Недостающие поля объекта берутся из профиля 5
+    static difficulty_profile parse(const json &setting)
+    {
+        if (setting.is_number_integer())
+            return level(setting.get<int>());
+        if (!setting.is_object())
+            throw std::runtime_error("bad bot level " + setting.dump());
+        difficulty_profile res = level(5);
+        res.depth = setting.value("Depth", res.depth);
+        res.nodes = setting.value("Nodes", res.nodes);
+        res.time_ms = setting.value("TimeMS", res.time_ms);
+        res.noise = setting.value("Noise", res.noise);
+        if (res.depth < 1 || res.noise < 0)
+            throw std::runtime_error("bad bot level " + setting.dump());
+        return res;
+    }
+
+    // Ограничения поиска для профиля
+    static search_limits limits(const difficulty_profile &profile)
+    {
+        search_limits res;
+        res.depth = profile.depth;
+        res.nodes = profile.nodes;
+        res.time_ms = profile.time_ms;
+        return res;
+    }
+};
@@ -0,0 +1,255 @@
+#pragma once
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "Logic.h"
+#include "Notation.h"
+#include "Options.h"
+#include "TransTable.h"
+
+// Текстовый протокол движка через стандартный ввод и вывод (режим "engine")
+// Позволяет встраивать бота в сторонние интерфейсы и тестовые стенды без окна SDL
+//
+// Команды (по одной в строке):
+// isready                                  - ответ "readyok" (сразу, даже во время поиска)
+// newgame                                  - новая партия (сброс настроек поиска)
+// setoption name <имя> value <значение>   - настройка бота: Optimization, BotScoringType, NnueWeights, EvalWeights,
+//                                            NoRandom, Hash (размер таблицы транспозиций в МБ, по умолчанию 16),
+//                                            SharedHash (имя таблицы в разделяемой памяти, общей для всех
+//                                            процессов движка с этим именем; пустое значение - своя таблица)
+// position <startpos|[fen] FEN> [moves <ход> ...] - установка позиции
+// moves <ход> ...                          - выполнение ходов в текущей позиции
+// go [depth D] [movetime MS] [nodes N] [infinite] - запуск поиска в отдельном потоке
+// stop                                     - остановка поиска (выводится лучший найденный ход)
+// d                                        - вывод текущей позиции в FEN
+// quit                                     - выход
+//
+// Ответы движка:
+// info depth D score S nodes N nps X time T pv <ход> - после каждой итерации поиска
+// bestmove <ход>                                     - результат поиска ("bestmove none", если ходов нет)
+// error <описание>                                   - ошибка в команде
+class Engine
+{
+  public:
+    Engine()
+        : settings{{"Bot", {{"NoRandom", true},
+                            {"BotScoringType", "NumberAndPotential"},
+                            {"Optimization", "O1"}}}}
+    {
+        new_game();
+    }
+
+    ~Engine()
+    {
+        stop_search();
+    }
+
+    // Цикл обработки команд до команды quit или конца ввода
+    int run()
+    {
+        string line;
+        while (getline(cin, line))
+        {
+            stringstream ss(line);
+            string command;
+            if (!(ss >> command))
+                continue;
+            try
+            {
+                if (command == "quit")
+                    break;
+                else if (command == "isready")
+                    print("readyok");
+                else if (command == "newgame")
+                {
+                    stop_search();
+                    new_game();
+                }
+                else if (command == "setoption")
+                    set_option(ss);
+                else if (command == "position")
+                {
+                    stop_search();
+                    set_position(line.substr(line.find("position") + 8));
+                }
+                else if (command == "moves")
+                {
+                    stop_search();
+                    string move;
+                    while (ss >> move)
+                        apply_move(move);
+                }
+                else if (command == "go")
+                    go(ss);
+                else if (command == "stop")
+                    stop_search();
+                else if (command == "d")
+                    print(Notation::to_fen(pos));
+                else
+                    print("error unknown command '" + command + "'");
+            }
+            catch (const exception &e)
+            {
+                print(string("error ") + e.what());
+            }
+        }
+        stop_search();
+        return 0;
+    }
+
+  private:
+    // Новая партия: начальная позиция и новый экземпляр логики с текущими настройками
+    void new_game()
+    {
+        config = Config(settings);
+        make_logic();
+        pos = game_position{Board::start_mtx(), false};
+        history.assign(1, pos.mtx);
+    }
+
+    // Обработка команды "setoption name <имя> value <значение>"
+    void set_option(stringstream &ss)
+    {
+        string word, name, value;
+        ss >> word >> name >> word >> value;
+        if (name == "Hash" || name == "SharedHash")
+        {
+            stop_search();
+            set_hash(name, value);
+            return;
+        }
+        if (name != "Optimization" && name != "BotScoringType" && name != "NnueWeights" && name != "EvalWeights" &&
+            name != "NoRandom")
+            throw runtime_error("unknown option '" + name + "'");
+        int level;
+        bool use_mtdf;
+        if (name == "Optimization" && !Logic::parse_optimization(value, level, use_mtdf))
+            throw runtime_error("bad value '" + value + "' of option Optimization");
+        stop_search();
+        // Новые настройки проверяются на копии: при ошибке (например, нет файла весов) остаются прежние
+        json changed = settings;
+        if (name == "NoRandom")
+            changed["Bot"][name] = (value == "true");
+        else
+            changed["Bot"][name] = value;
+        Config checked_config(changed);
+        Logic check(nullptr, &checked_config);
+        settings = move(changed);
+        config = Config(settings);
+        make_logic();
+    }
+
+    // Новый экземпляр логики с текущими настройками и таблицей транспозиций движка
+    void make_logic()
+    {
+        logic = make_unique<Logic>(nullptr, &config);
+        logic->stop_flag = &stop_flag;
+        logic->tt = &tt;
+    }
+
+    // Настройка таблицы транспозиций: Hash - размер в МБ, SharedHash - имя таблицы в разделяемой памяти
+    // При ошибке подключения остается прежняя таблица
+    void set_hash(const string &name, const string &value)
+    {
+        if (name == "Hash")
+        {
+            if (!Options::parse_number(value, hash_mb, size_t(0), size_t(65536)))
+                throw runtime_error("bad value '" + value + "' of option Hash");
+        }
+        else
+            shared_hash = value;
+        if (shared_hash.empty())
+            tt.resize(hash_mb);
+        else
+            tt.attach(shared_hash, hash_mb);
+    }
+
+    // Установка позиции по строке "<startpos|FEN> [moves <ход> ...]"
+    void set_position(const string &text)
+    {
+        stringstream ss(text);
+        string token;
+        ss >> token;
+        // Слово "fen" перед позицией необязательно
+        if (token == "fen")
+            ss >> token;
+        pos = (token == "startpos") ? game_position{Board::start_mtx(), false} : Notation::parse_fen(token);
+        history.assign(1, pos.mtx);
+        if (ss >> token && token != "moves")
+            throw runtime_error("expected 'moves' after position, got '" + token + "'");
+        while (ss >> token)
+            apply_move(token);
+    }
+
+    // Выполнение хода в текущей позиции
+    void apply_move(const string &text)
+    {
+        pos = Notation::make_move(*logic, pos, Notation::parse_move(*logic, pos, text));
+        history.push_back(pos.mtx);
+    }
+
+    // Обработка команды "go": запуск поиска в отдельном потоке
+    void go(stringstream &ss)
+    {
+        stop_search();
+        search_limits limits;
+        string token;
+        while (ss >> token)
+        {
+            if (token == "infinite")
+                continue;
+            if (token != "depth" && token != "movetime" && token != "nodes")
+                throw runtime_error("unknown go parameter '" + token + "'");
+            // Значение - положительное число без лишних символов (0 в limits означает "без ограничения")
+            string value;
+            ss >> value;
+            const bool valid = (token == "depth")      ? Options::parse_number(value, limits.depth, 1, 64)
+                               : (token == "movetime") ? Options::parse_number(value, limits.time_ms, int64_t(1),
+                                                                               numeric_limits<int64_t>::max())
+                                                       : Options::parse_number(value, limits.nodes, uint64_t(1),
+                                                                               numeric_limits<uint64_t>::max());
+            if (!valid)
+                throw runtime_error("bad go parameter '" + token + " " + value + "'");
+        }
+        stop_flag = false;
+        worker = thread([this, limits, pos = pos, history = history] {
+            auto info = logic->search(pos.mtx, pos.color, history, limits, [this](const search_info &it) {
+                print("info depth " + to_string(it.depth) + " score " + to_string(it.score) + " nodes " +
+                      to_string(it.nodes) + " nps " + to_string(it.nodes * 1000 / max<int64_t>(1, it.time_ms)) +
+                      " time " + to_string(it.time_ms) + " pv " + Notation::move_to_string(it.best));
+            });
+            print("bestmove " + (info.best.empty() ? string("none") : Notation::move_to_string(info.best)));
+        });
+    }
+
+    // Остановка поиска и ожидание завершения потока поиска
+    void stop_search()
+    {
+        stop_flag = true;
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // Потокобезопасный вывод строки ответа
+    void print(const string &text)
+    {
+        lock_guard<mutex> lock(out_mtx);
+        cout << text << endl;
+    }
+
+    json settings;                 // Настройки бота, изменяемые командой setoption
+    Config config{json::object()};
+    unique_ptr<Logic> logic;
+    TransTable tt;                 // Таблица транспозиций (своя или в разделяемой памяти)
+    size_t hash_mb = 16;           // Размер таблицы транспозиций в МБ
+    string shared_hash;            // Имя таблицы в разделяемой памяти (пустое - своя таблица)
+    game_position pos;             // Текущая позиция
+    vector<vector<vector<POS_T>>> history;  // Позиции партии для учета повторений
+    atomic<bool> stop_flag{false}; // Флаг остановки поиска
+    thread worker;                 // Поток поиска
+    mutex out_mtx;
+};
@@ -1,22 +1,45 @@
 #pragma once
+#include <atomic>
 #include <chrono>
+#include <mutex>
 #include <thread>
 
 #include "../Models/Project_path.h"
+#include "Archive.h"
 #include "Board.h"
 #include "Config.h"
+#include "Difficulty.h"
 #include "Hand.h"
 #include "Logic.h"
+#include "Mcts.h"
+#include "Notation.h"
+#include "Scheduler.h"
+#include "Solver.h"
+#include "TransTable.h"
 
 class Game
 {
   public:
-    Game() : board(config("WindowSize", "Width"), config("WindowSize", "Hight")), hand(&board), logic(&board, &config)
+    Game() : board(config("WindowSize", "Width"), config("WindowSize", "Hight")), hand(&board), logic(&board, &config),
+             tt(config.value("Bot", "HashMB", 16).get<size_t>()), hint_logic(nullptr, &config)
     {
+        // Таблица транспозиций, таблицы истории и ожидаемый ответ соперника сохраняются
+        // между ходами бота и между партиями
+        // Непустое SharedHash - таблица в разделяемой памяти, общая для всех процессов с этим именем
+        const string shared_hash = config.value("Bot", "SharedHash", "").get<string>();
+        if (!shared_hash.empty())
+            tt.attach(shared_hash, config.value("Bot", "HashMB", 16).get<size_t>());
+        logic.tt = &tt;
+        hint_logic.tt = &tt;
         ofstream fout(project_path + "log.txt", ios_base::trunc);
         fout.close();
     }
 
+    ~Game()
+    {
+        stop_adjudication();
+    }
+
     // Основная функция игры, управляет игровым процессом
     int play()
     {
@@ -26,8 +49,12 @@ class Game
         // Если это повторная игра, перезагружаем настройки и доску
         if (is_replay)
         {
-            logic = Logic(&board, &config);
             config.reload();
+            logic.configure();
+            logic.new_game();
+            hint_logic.configure();
+            hint_logic.new_game();
+            mcts.reset();
             board.redraw();
         }
         else
@@ -36,29 +63,46 @@ class Game
             board.start_draw();
         }
         is_replay = false;
+        load_bot_profiles();
 
         // Основной игровой цикл
         int turn_num = -1;  // Номер текущего хода
         bool is_quit = false;  // Флаг выхода из игры
+        bool is_draw = false;  // Флаг ничьей по правилам (повторение позиции, ходы только дамками)
+        int adjudged = 0;  // Результат, доказанный решателем досрочно (0 - нет, иначе как в show_final)
         const int Max_turns = config("Game", "MaxNumTurns");  // Максимальное количество ходов
         
         while (++turn_num < Max_turns)
         {
             beat_series = 0;  // Сброс серии взятий
+
+            // Проверка правил ничьей для текущей позиции
+            if (is_draw_by_rules())
+            {
+                is_draw = true;
+                break;
+            }
+
             logic.find_turns(turn_num % 2);  // Поиск возможных ходов для текущего игрока
             
             // Если ходов нет - игра окончена
             if (logic.turns.empty())
                 break;
+
+            // Досрочное завершение партии, если решатель доказал выигрыш одной из сторон,
+            // и решение новой позиции, пока выбирается ход
+            adjudged = finish_adjudication();
+            if (adjudged)
+                break;
+            start_adjudication(turn_num % 2, turn_num);
                 
-            // Установка уровня сложности бота для текущего игрока
-            logic.Max_depth = config("Bot", string((turn_num % 2) ? "Black" : "White") + string("BotLevel"));
-            
             // Проверка, является ли текущий игрок человеком или ботом
             if (!config("Bot", string("Is") + string((turn_num % 2) ? "Black" : "White") + string("Bot")))
             {
-                // Ход игрока-человека
+                // Ход игрока-человека, пока он думает, ищется подсказка
+                start_hint(turn_num % 2);
                 auto resp = player_turn(turn_num % 2);
+                stop_hint();
                 if (resp == Response::QUIT)
                 {
                     is_quit = true;
@@ -87,9 +131,24 @@ class Game
                 }
             }
             else
-                bot_turn(turn_num % 2);  // Ход бота
+            {
+                // Ход бота; пока он думает, окно можно закрыть или начать новую партию
+                auto resp = bot_turn(turn_num % 2);
+                if (resp == Response::QUIT)
+                {
+                    is_quit = true;
+                    break;
+                }
+                else if (resp == Response::REPLAY)
+                {
+                    is_replay = true;
+                    break;
+                }
+            }
         }
         
+        stop_adjudication();
+
         // Записываем время игры в лог
         auto end = chrono::steady_clock::now();
         ofstream fout(project_path + "log.txt", ios_base::app);
@@ -104,15 +163,21 @@ class Game
             
         // Определение результата игры
         int res = 2;  // По умолчанию - ничья
-        if (turn_num == Max_turns)
+        if (adjudged)
         {
-            res = 0;  // Превышено максимальное количество ходов
+            res = adjudged;  // Выигрыш доказан решателем
+        }
+        else if (turn_num == Max_turns || is_draw)
+        {
+            res = 0;  // Превышено максимальное количество ходов или ничья по правилам
         }
         else if (turn_num % 2)
         {
             res = 1;  // Победа одного из игроков
         }
         
+        archive(res);
+
         // Показ финального экрана и ожидание действия игрока
         board.show_final(res);
         auto resp = hand.wait();
@@ -125,9 +190,159 @@ class Game
     }
 
   private:
+    // Профили сложности и типы ботов из настроек проверяются один раз в начале партии:
+    // неверный уровень или тип - ошибка настроек, а не исключение посреди хода бота
+    // Тип бота: "Minimax" - поиск Logic, "MCTS" - поиск по дереву методом Монте-Карло (см. Mcts.h)
+    void load_bot_profiles()
+    {
+        for (const bool color : {false, true})
+        {
+            const string side = color ? "Black" : "White";
+            if (!config("Bot", "Is" + side + "Bot"))
+                continue;
+            bot_profiles[color] = Difficulty::parse(config("Bot", side + "BotLevel"));
+            bot_types[color] = config.value("Bot", side + "BotType", "Minimax").get<string>();
+            if (bot_types[color] != "Minimax" && bot_types[color] != "MCTS")
+                throw runtime_error("unknown bot type " + bot_types[color]);
+        }
+    }
+
+    // Досрочное завершение партии: в позиции с небольшим числом шашек (не больше AdjudicatePieces)
+    // решатель пытается доказать выигрыш или проигрыш ходящего, раскрывая не больше AdjudicateNodes позиций
+    // Решение идет в отдельном потоке, пока игрок или бот выбирают ход, и проверяется в начале
+    // следующего хода (см. finish_adjudication), поэтому окно не ждет решателя
+    // Выигрыш засчитывается, только если проигравшая сторона остается без ходов раньше ничьей по правилам:
+    // до предела MaxNumTurns и до KingMovesDraw ходов только дамками; повторения позиций партии
+    // решатель считает неудачей выигрывающей стороны
+    // Параметры: color - ходящий (true - черные, false - белые), turn_num - номер текущего хода
+    void start_adjudication(const bool color, const int turn_num)
+    {
+        const int max_pieces = config.value("Game", "AdjudicatePieces", 0).get<int>();
+        if (max_pieces <= 0)
+            return;
+        const auto mtx = board.get_board();
+        int pieces = 0;
+        for (const auto &row : mtx)
+            pieces += int(count_if(row.begin(), row.end(), [](const POS_T cell) { return cell != 0; }));
+        if (pieces > max_pieces)
+            return;
+        // Число полуходов, за которые проигравшая сторона должна остаться без ходов
+        auto history = board.move_history();
+        int max_plies = config("Game", "MaxNumTurns").get<int>() - 1 - turn_num;
+        const int king_moves = config("Game", "KingMovesDraw");
+        if (king_moves > 0)
+        {
+            int reversible = 0;  // Ходов подряд только дамками без взятий (как в Logic::is_draw_by_rules)
+            for (size_t i = history.size() - 1; i > 0 && Logic::is_reversible(history[i - 1], history[i]); --i)
+                ++reversible;
+            max_plies = min(max_plies, 2 * king_moves - 1 - reversible);
+        }
+        if (max_plies <= 0)
+            return;
+        adjudication_mtx = mtx;
+        adjudication_color = color;
+        adjudication_size = history.size();
+        adjudication = proof_info();
+        adjudication_stop = false;
+        solver.stop_flag = &adjudication_stop;
+        const uint64_t max_nodes = config.value("Game", "AdjudicateNodes", 50000).get<uint64_t>();
+        adjudicator = thread([this, mtx, color, max_nodes, max_plies, history = std::move(history)] {
+            adjudication = solver.solve(mtx, color, max_nodes, max_plies, history);
+        });
+    }
+
+    // Остановка решателя (если он еще работает) без учета результата
+    void stop_adjudication()
+    {
+        if (!adjudicator.joinable())
+            return;
+        adjudication_stop = true;
+        adjudicator.join();
+    }
+
+    // Итог решения, начатого на прошлом ходе (start_adjudication), для текущей позиции партии
+    // Незаконченное решение прерывается. Доказанный проигрыш ходившего засчитывается при любом его ходе,
+    // доказанный выигрыш - только если сделан ход из доказательства
+    // Возвращает результат партии как в Board::show_final (1 - выиграли белые, 2 - черные)
+    // или 0, если ничего не доказано
+    int finish_adjudication()
+    {
+        if (!adjudicator.joinable())
+            return 0;
+        stop_adjudication();
+        const auto history = board.move_history();
+        const proof_info &info = adjudication;
+        if (info.result == Proof::UNKNOWN || history.size() != adjudication_size + 1 ||
+            history[history.size() - 2] != adjudication_mtx)
+            return 0;
+        if (info.result == Proof::WON)
+        {
+            const auto chains = logic.find_chains(adjudication_color, adjudication_mtx);
+            const auto played = find_if(chains.begin(), chains.end(), [&](const auto &chain) {
+                return logic.make_turn(adjudication_mtx, chain) == history.back();
+            });
+            if (played == chains.end() || played->path != info.best)
+                return 0;
+        }
+        ofstream fout(project_path + "log.txt", ios_base::app);
+        fout << "Adjudicated: " << (info.result == Proof::WON ? "side to move wins" : "side to move loses")
+             << ", proof tree " << info.proof_size << " nodes, searched " << info.nodes << "\n";
+        fout.close();
+        const bool white_wins = (info.result == Proof::WON) != adjudication_color;
+        return white_wins ? 1 : 2;
+    }
+
+    // Запись законченной партии в архив (настройка ArchiveFile, пустое имя - не записывать)
+    // Ходы восстанавливаются по позициям после полных ходов: среди разрешенных ищется ход,
+    // приводящий к следующей позиции
+    // Параметр res - результат партии как в Board::show_final
+    void archive(const int res)
+    {
+        const string path = config.value("Game", "ArchiveFile", "").get<string>();
+        if (path.empty())
+            return;
+        const auto positions = board.move_history();
+        vector<vector<move_pos>> moves;
+        for (size_t i = 0; i + 1 < positions.size() && moves.size() == i; ++i)
+        {
+            for (const auto &chain : logic.find_chains(i % 2, positions[i]))
+            {
+                if (logic.make_turn(positions[i], chain) == positions[i + 1])
+                {
+                    moves.push_back(chain.path);
+                    break;
+                }
+            }
+        }
+        ofstream fout(project_path + "log.txt", ios_base::app);
+        if (moves.size() + 1 != positions.size())
+        {
+            fout << "Error: can't restore moves of the game for archive " << path << "\n";
+            return;
+        }
+        try
+        {
+            ArchiveWriter(project_path + path).append(moves, res == 1 ? 1 : res == 2 ? -1 : 0);
+        }
+        catch (const exception &e)
+        {
+            fout << "Error: " << e.what() << "\n";
+        }
+    }
+
+    // Проверяет правила ничьей для текущей позиции партии (см. Logic::is_draw_by_rules)
+    // Возвращает true, если партия закончилась ничьей
+    bool is_draw_by_rules() const
+    {
+        return Logic::is_draw_by_rules(board.move_history(), config("Game", "RepetitionDraw"),
+                                       config("Game", "KingMovesDraw"));
+    }
+
     // Обработка хода бота
     // Параметр color: true - черные, false - белые
-    void bot_turn(const bool color)
+    // Возвращает Response::OK после хода бота,
+    // Response::QUIT или Response::REPLAY, если пока бот думал, окно закрыли или начали новую игру
+    Response bot_turn(const bool color)
     {
         // Засекаем время начала хода
         auto start = chrono::steady_clock::now();
@@ -137,10 +352,81 @@ class Game
         
         // Создаем отдельный поток для обеспечения минимальной задержки хода
         // Это нужно, чтобы бот не делал ходы слишком быстро
+        // Поток ожидается при любом выходе из функции, в том числе по исключению
         thread th(SDL_Delay, delay_ms);
+        struct JoinOnExit
+        {
+            thread &th;
+            ~JoinOnExit()
+            {
+                if (th.joinable())
+                    th.join();
+            }
+        } delay_join{th};
         
-        // Находим лучшую последовательность ходов для текущего состояния
-        auto turns = logic.find_best_turns(color);
+        // Находим лучшую последовательность ходов для текущего состояния с ограничениями
+        // профиля сложности бота (глубина, число позиций, время)
+        const difficulty_profile &profile = bot_profiles[color];
+        search_info info;
+        if (bot_types[color] == "MCTS")
+        {
+            // Поиск идет в отдельном потоке, а этот поток обрабатывает события окна;
+            // при закрытии окна или новой партии поиск останавливается флагом
+            if (!mcts)
+                mcts = make_unique<Mcts>(&config);
+            atomic<bool> stop{false}, finished{false};
+            exception_ptr error;
+            mcts->stop_flag = &stop;
+            thread searcher([&, mtx = board.get_board()] {
+                try
+                {
+                    info = mcts->search(mtx, color, Difficulty::limits(profile));
+                }
+                catch (...)
+                {
+                    error = current_exception();
+                }
+                finished = true;
+            });
+            JoinOnExit search_join{searcher};
+            Response resp = Response::OK;
+            while (!finished)
+            {
+                resp = hand.poll();
+                if (resp != Response::OK)
+                {
+                    stop = true;
+                    break;
+                }
+                SDL_Delay(POLL_MS);
+            }
+            searcher.join();
+            mcts->stop_flag = nullptr;
+            if (error)
+                rethrow_exception(error);
+            if (resp != Response::OK)
+                return resp;
+        }
+        else
+        {
+            // Поиск идет квантами планировщика в этом же потоке (см. SearchScheduler):
+            // между квантами обрабатываются события окна
+            logic.eval_noise = profile.noise;
+            auto task = scheduler.submit(logic, board.get_board(), color, board.move_history(),
+                                         Difficulty::limits(profile));
+            Response resp = Response::OK;
+            while (scheduler.run_one())
+            {
+                if (resp == Response::OK)
+                    resp = hand.poll();
+                if (resp != Response::OK)
+                    task->cancel();
+            }
+            if (resp != Response::OK)
+                return resp;
+            info = task->result();
+        }
+        auto turns = info.best;
         th.join();  // Ждем окончания задержки
         
         bool is_first = true;
@@ -165,8 +451,78 @@ class Game
         // Записываем время хода в лог
         auto end = chrono::steady_clock::now();
         ofstream fout(project_path + "log.txt", ios_base::app);
-        fout << "Bot turn time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
+        fout << "Bot turn time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec, depth "
+             << info.depth << ", nodes " << info.nodes << "\n";
         fout.close();
+        return Response::OK;
+    }
+
+    // Подсказка для игрока-человека: пока он думает, поток подсказки ищет HintLines лучших ходов
+    // с оценками (multi-PV), уточняя их с каждой итерацией углубления до глубины HintDepth
+    // Поиск идет в своей логике, но с общей таблицей транспозиций, поэтому следующий поиск бота
+    // начинается с уже найденных оценок - только у бота без случайной добавки к оценке (уровень 5 и выше
+    // или профиль с Noise 0): ключи поиска с добавкой зависят от ее зерна, и записи подсказки ему не видны
+    // Главный поток только читает последний результат, клики поиска не ждут
+    // Параметр color: true - черные, false - белые
+    void start_hint(const bool color)
+    {
+        const int lines = config.value("Game", "HintLines", 0).get<int>();
+        if (lines <= 0)
+            return;
+        {
+            lock_guard<mutex> lock(hint_mtx);
+            hint = search_info();
+        }
+        search_limits limits;
+        limits.depth = config.value("Game", "HintDepth", 20).get<int>();
+        hint_logic.multi_pv = lines;
+        hint_task = hint_scheduler.submit(hint_logic, board.get_board(), color, board.move_history(), limits, 0,
+                                          nullptr, [this](const search_info &info) {
+                                              lock_guard<mutex> lock(hint_mtx);
+                                              hint = info;
+                                          });
+    }
+
+    // Остановка поиска подсказки после хода игрока и удаление подсказки с доски
+    void stop_hint()
+    {
+        if (!hint_task)
+            return;
+        hint_task->cancel();
+        hint_task->wait();  // Поиск прерывается на ближайшей проверке ограничений, логика свободна для следующего
+        hint_task.reset();
+        board.clear_hint();
+        board.set_title("Checkers");
+    }
+
+    // Показ подсказки: лучший ход подсвечивается на доске, лучшие ходы с оценками выводятся в заголовок окна
+    void show_hint()
+    {
+        if (!hint_task)
+        {
+            board.set_title("Checkers - hints are off (Game.HintLines)");
+            return;
+        }
+        search_info info;
+        {
+            lock_guard<mutex> lock(hint_mtx);
+            info = hint;
+        }
+        if (info.best.empty())  // Первая итерация еще не закончена
+        {
+            board.set_title("Checkers - hint: thinking...");
+            return;
+        }
+        vector<pair<POS_T, POS_T>> cells{{info.best.front().x, info.best.front().y}};
+        for (const auto &turn : info.best)
+            cells.emplace_back(turn.x2, turn.y2);
+        board.highlight_hint(cells);
+        if (info.lines.empty())
+            info.lines.push_back(search_line{info.score, info.best});
+        string title = "Checkers - hint, depth " + to_string(info.depth) + ":";
+        for (const auto &line : info.lines)
+            title += " " + Notation::move_to_string(line.move) + " (" + to_string(line.score) + ")";
+        board.set_title(title);
     }
 
     // Обработка хода игрока
@@ -192,6 +548,11 @@ class Game
         while (true)
         {
             auto resp = hand.get_cell();  // Получаем клетку, выбранную игроком
+            if (get<0>(resp) == Response::HINT)  // Показываем лучший ход, найденный к этому моменту
+            {
+                show_hint();
+                continue;
+            }
             if (get<0>(resp) != Response::CELL)
                 return get<0>(resp);  // Если получена не клетка, возвращаем полученный ответ
             pair<POS_T, POS_T> cell{get<1>(resp), get<2>(resp)};  // Координаты выбранной клетки
@@ -272,6 +633,8 @@ class Game
             while (true)
             {
                 auto resp = hand.get_cell();
+                if (get<0>(resp) == Response::HINT)
+                    continue;
                 if (get<0>(resp) != Response::CELL)
                     return get<0>(resp);
                 pair<POS_T, POS_T> cell{get<1>(resp), get<2>(resp)};
@@ -307,6 +670,26 @@ class Game
     Board board;
     Hand hand;
     Logic logic;
+    SearchScheduler scheduler{0};  // Поиск хода бота без отдельных потоков (см. bot_turn)
+    TransTable tt;
+    // Досрочное завершение партий (см. start_adjudication)
+    Solver solver;
+    thread adjudicator;  // Поток решателя
+    atomic<bool> adjudication_stop{false};
+    proof_info adjudication;  // Итог решения (читается после завершения потока)
+    vector<vector<POS_T>> adjudication_mtx;  // Решаемая позиция, ее ходящий и длина истории партии
+    bool adjudication_color = false;
+    size_t adjudication_size = 0;
+    unique_ptr<Mcts> mcts;  // Бот MCTS (создается при первом ходе бота этого типа)
+    difficulty_profile bot_profiles[2];  // Профили сложности белого и черного ботов (см. load_bot_profiles)
+    string bot_types[2];                 // Типы белого и черного ботов
+    static constexpr int POLL_MS = 10;   // Период обработки событий окна, пока думает бот MCTS
     int beat_series;
     bool is_replay = false;
+    // Подсказка игроку (см. start_hint)
+    Logic hint_logic;
+    mutex hint_mtx;
+    search_info hint;  // Последняя завершенная итерация поиска подсказки
+    shared_ptr<SearchTask> hint_task;
+    SearchScheduler hint_scheduler{1};  // Поток подсказки (уничтожается первым, до логики подсказки)
 };
@@ -5,7 +5,7 @@
 #include "../Models/Response.h"
 #include "Board.h"
 
-// Класс для обработки пользовательского ввода (мышь, окно)
+// Класс для обработки пользовательского ввода (мышь, клавиатура, окно)
 class Hand
 {
   public:
@@ -16,7 +16,7 @@ class Hand
 
     // Получает координаты выбранной клетки и тип действия
     // Возвращает кортеж из:
-    // - Response: тип действия (QUIT, BACK, REPLAY, CELL)
+    // - Response: тип действия (QUIT, BACK, REPLAY, CELL, HINT)
     // - POS_T: координата x выбранной клетки (-1 если не выбрана)
     // - POS_T: координата y выбранной клетки (-1 если не выбрана)
     tuple<Response, POS_T, POS_T> get_cell() const
@@ -39,19 +39,19 @@ class Hand
                     x = windowEvent.motion.x;
                     y = windowEvent.motion.y;
                     // Преобразование координат экрана в координаты доски
-                    xc = int(y / (board->H / 10) - 1);
-                    yc = int(x / (board->W / 10) - 1);
+                    xc = int(y / (board->H / Board::CELLS) - 1);
+                    yc = int(x / (board->W / Board::CELLS) - 1);
                     
                     // Проверка специальных зон клика
                     if (xc == -1 && yc == -1 && board->history_mtx.size() > 1)  // Кнопка "назад"
                     {
                         resp = Response::BACK;
                     }
-                    else if (xc == -1 && yc == 8)  // Кнопка "новая игра"
+                    else if (xc == -1 && yc == Board::Rules::SIZE)  // Кнопка "новая игра"
                     {
                         resp = Response::REPLAY;
                     }
-                    else if (xc >= 0 && xc < 8 && yc >= 0 && yc < 8)  // Клетка на доске
+                    else if (xc >= 0 && xc < Board::Rules::SIZE && yc >= 0 && yc < Board::Rules::SIZE)  // Клетка на доске
                     {
                         resp = Response::CELL;
                     }
@@ -67,6 +67,11 @@ class Hand
                         board->reset_window_size();
                         break;
                     }
+                    break;
+                case SDL_KEYDOWN:  // Клавиша H - подсказка
+                    if (windowEvent.key.keysym.sym == SDLK_h)
+                        resp = Response::HINT;
+                    break;
                 }
                 if (resp != Response::OK)
                     break;
@@ -99,9 +104,9 @@ class Hand
                     int x = windowEvent.motion.x;
                     int y = windowEvent.motion.y;
                     // Преобразование координат экрана в координаты доски
-                    int xc = int(y / (board->H / 10) - 1);
-                    int yc = int(x / (board->W / 10) - 1);
-                    if (xc == -1 && yc == 8)  // Клик по кнопке "новая игра"
+                    int xc = int(y / (board->H / Board::CELLS) - 1);
+                    int yc = int(x / (board->W / Board::CELLS) - 1);
+                    if (xc == -1 && yc == Board::Rules::SIZE)  // Клик по кнопке "новая игра"
                         resp = Response::REPLAY;
                 }
                 break;
@@ -113,6 +118,38 @@ class Hand
         return resp;
     }
 
+    // Обрабатывает накопившиеся события окна, не дожидаясь новых (пока бот думает)
+    // Возвращает:
+    // - Response::QUIT при закрытии окна
+    // - Response::REPLAY при нажатии кнопки "новая игра"
+    // - Response::OK, если действий пользователя нет (клики по доске пропускаются)
+    Response poll() const
+    {
+        SDL_Event windowEvent;
+        Response resp = Response::OK;
+        while (resp == Response::OK && SDL_PollEvent(&windowEvent))
+        {
+            switch (windowEvent.type)
+            {
+            case SDL_QUIT:  // Закрытие окна
+                resp = Response::QUIT;
+                break;
+            case SDL_MOUSEBUTTONDOWN: {  // Клик мышью
+                int xc = int(windowEvent.motion.y / (board->H / Board::CELLS) - 1);
+                int yc = int(windowEvent.motion.x / (board->W / Board::CELLS) - 1);
+                if (xc == -1 && yc == Board::Rules::SIZE)  // Клик по кнопке "новая игра"
+                    resp = Response::REPLAY;
+            }
+            break;
+            case SDL_WINDOWEVENT:  // Изменение размера окна
+                if (windowEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                    board->reset_window_size();
+                break;
+            }
+        }
+        return resp;
+    }
+
   private:
     Board *board;  // Указатель на игровую доску
 };
@@ -1,25 +1,72 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <numeric>
 #include <random>
 #include <vector>
 
+#include "../Models/EvalWeights.h"
 #include "../Models/Move.h"
+#include "../Models/Search.h"
+#include "Arena.h"
+#include "BatchEval.h"
 #include "Board.h"
 #include "Config.h"
+#include "Nnue.h"
+#include "Rays.h"
+#include "Rules.h"
+#include "TransTable.h"
+#include "Zobrist.h"
 
 const int INF = 1e9;
 
+// Масштаб целочисленной оценки позиции: оценка лежит в пределах (-SCORE_SCALE, SCORE_SCALE),
+// выигрыш и проигрыш оцениваются как +-(INF - ply)
+const int SCORE_SCALE = 10000;
+
+// Параметры выборочного поиска (в единицах целочисленной оценки,
+// одна шашка при равном материале - примерно 400 единиц)
+const int FUTILITY_MARGIN = 300;  // Запас для отсечения бесперспективных тихих ходов у листьев
+const int RAZOR_MARGIN = 600;     // Запас для сокращения глубины на предпоследнем уровне
+const int PROBCUT_MARGIN = 200;   // Запас для отсечения по результату неглубокого поиска
+const int PROBCUT_DEPTH = 4;      // Минимальная оставшаяся глубина для ProbCut
+const int PROBCUT_REDUCTION = 3;  // На сколько уменьшается глубина проверочного поиска ProbCut
+const int LMR_DEPTH = 3;          // Минимальная оставшаяся глубина для сокращения поздних ходов
+const int LMR_MOVE_NUM = 3;       // Номер хода в списке, начиная с которого ход считается поздним
+
 // Класс, реализующий игровую логику и искусственный интеллект для игры в шашки
 // 
 // Основные особенности:
 // 1. Использует алгоритм минимакс с альфа-бета отсечением для поиска лучшего хода
 // 2. Поддерживает настраиваемую глубину поиска (Max_depth)
-// 3. Имеет два режима оценки позиции:
+// 3. Имеет три режима оценки позиции:
 //    - "Number" - учитывает только количество шашек
 //    - "NumberAndPotential" - учитывает количество шашек и их близость к превращению в дамки
-// 4. Поддерживает оптимизацию поиска:
-//    - "O0" - без оптимизации
-//    - Другие значения - с альфа-бета отсечением, которое значительно уменьшает
+//    - "NNUE" - нейросетевая оценка (см. Nnue.h) с весами из файла, заданного настройкой "NnueWeights";
+//      накопители сети обновляются после каждого хода поиска, а не считаются заново
+// 4. Поддерживает оптимизацию поиска (уровни включаются накопительно):
+//    - "O0" - без оптимизации (полный минимакс)
+//    - "O1" - альфа-бета отсечение, которое значительно уменьшает
 //      количество рассматриваемых позиций за счет пропуска заведомо невыгодных вариантов
+//    - "O2" - сортировка ходов (взятия, превращения, ходы-убийцы, история), поиск с нулевым окном
+//      и перепоиском (PVS) и сокращение глубины для поздних тихих ходов (LMR)
+//    - "O3" - отсечение бесперспективных тихих ходов у листьев (futility) и сокращение глубины
+//      на предпоследнем уровне (razoring)
+//    - "O4" - отсечение по результату неглубокого поиска (ProbCut)
+//    Суффикс "-MTDF" (например "O2-MTDF") заменяет поиск в корне с полным окном на MTD(f): оценка
+//    уточняется серией поисков с нулевым окном вокруг оценки прошлой итерации углубления
+//    (нужны таблица транспозиций и уровень не ниже "O1", иначе суффикс не действует). Оценка MTD(f)
+//    может отличаться от оценки поиска с полным окном той же глубины (см. search_mtdf)
+//    Взятия и превращения в дамку никогда не сокращаются и не отсекаются выборочными методами
+// 5. Учитывает историю партии: повторение позиции (по хешу Зобриста) внутри поиска оценивается как ничья
+// 6. Может использовать таблицу транспозиций (поле tt), в том числе общую для нескольких потоков
+// 7. Временные данные поиска (списки ходов, сортировка) размещаются в арене экземпляра, а доски -
+//    в заранее выделенных буферах по уровням, поэтому после прогрева поиск не обращается к куче
 //
 // Рекомендации по настройке:
 // 1. Max_depth (глубина поиска):
@@ -30,18 +77,99 @@ const int INF = 1e9;
 // 2. scoring_mode:
 //    - "Number" - для начинающих игроков
 //    - "NumberAndPotential" - для более опытных игроков
+//    - "NNUE" - для сравнения с обученными весами
 // 3. optimization:
 //    - "O0" - только для отладки
 //    - Рекомендуется всегда использовать альфа-бета отсечение
-class Logic
+//    - "O2"-"O4" можно сравнивать с "O1" по силе игры и скорости
+//
+// Параметр Rules - вариант правил (см. Rules.h): размер доски, превращение во время взятия,
+// обязательное взятие наибольшего числа шашек. Logic - русские шашки 8x8
+template <class Rules> class BasicLogic
 {
+    // Хеширование и пакетная оценка для доски этого варианта
+    typedef BasicZobrist<Rules> Zobrist;
+    typedef BasicBatchEval<Rules> BatchEval;
+
+    // Маска черных клеток и диагональные лучи для ходов дамок
+    typedef typename Rules::Bits Bits;
+    typedef Rays<Rules> KingRays;
+
+    // Максимальное число шагов в серии взятий (не больше числа шашек соперника в начале партии)
+    static constexpr int MAX_CHAIN_STEPS = Rules::START_ROWS * Rules::HALF + 4;
+
   public:
-    Logic(Board *board, Config *config) : board(board), config(config)
+    // Полный ход и список ходов, размещаемые в арене поиска
+    typedef basic_move_chain<ArenaAllocator<move_pos>> search_chain;
+    typedef arena_vector<search_chain> search_chains;
+
+    BasicLogic(Board *board, Config *config) : board(board), config(config)
     {
+        configure();
+        chain_boards.assign(MAX_CHAIN_STEPS, empty_board());
+    }
+
+    // Чтение настроек бота (вызывается конструктором и после перезагрузки настроек)
+    // Таблицы истории и ходов-убийц, ожидаемый ход соперника и таблица транспозиций
+    // при этом сохраняются: записи таблицы транспозиций другого режима оценки не смешиваются
+    // с новыми, потому что у них другой tt_salt
+    void configure()
+    {
+        no_random = (*config)("Bot", "NoRandom");
         rand_eng = std::default_random_engine (
-            !((*config)("Bot", "NoRandom")) ? unsigned(time(0)) : 0);
+            !no_random ? unsigned(time(0)) : 0);
         scoring_mode = (*config)("Bot", "BotScoringType");
+        potential_scoring = (scoring_mode == "NumberAndPotential");
+        // Настроенные веса материальной оценки (см. Tuner.h), без файла - веса по умолчанию
+        const string weights_file = config->value("Bot", "EvalWeights", "").get<string>();
+        if (potential_scoring && !weights_file.empty())
+            weights = load_weights(project_path + weights_file);
+        string nnue_file;
+        if (scoring_mode == "NNUE")
+        {
+            // Признаки сети заданы для 32 клеток доски 8x8
+            if (Rules::SIZE != 8)
+                throw runtime_error("NNUE evaluation supports only the 8x8 board");
+            nnue_file = config->value("Bot", "NnueWeights", "nnue.bin").get<string>();
+            nnue = Nnue::load(project_path + nnue_file);
+        }
         optimization = (*config)("Bot", "Optimization");
+        if (!parse_optimization(optimization, opt_level, mtdf))
+            throw runtime_error("bad setting Bot.Optimization '" + optimization +
+                                "': expected O0-O4, optionally with the -MTDF suffix");
+        // Оценки разных режимов подсчета очков не должны смешиваться в общей таблице транспозиций
+        tt_salt = 14695981039346656037ull;
+        for (char c : scoring_mode + nnue_file + (potential_scoring ? weights_file : ""))
+            tt_salt = (tt_salt ^ uint8_t(c)) * 1099511628211ull;
+    }
+
+    // Разбор уровня оптимизации вида "O<число>" с необязательным суффиксом "-MTDF" (см. описание класса)
+    // Уровни выше 4 включают все оптимизации, как O4
+    // Возвращает false, если значение записано в другом виде (level и use_mtdf тогда не меняются)
+    static bool parse_optimization(const string &value, int &level, bool &use_mtdf)
+    {
+        if (value.size() < 2 || value[0] != 'O')
+            return false;
+        const bool with_mtdf = value.size() > 5 && value.compare(value.size() - 5, 5, "-MTDF") == 0;
+        const string number = value.substr(1, value.size() - 1 - (with_mtdf ? 5 : 0));
+        if (number.empty() || number.size() > 2 ||
+            !all_of(number.begin(), number.end(), [](const char c) { return c >= '0' && c <= '9'; }))
+            return false;
+        level = stoi(number);
+        use_mtdf = with_mtdf;
+        return true;
+    }
+
+    // Начало новой партии: сбрасываются таблицы истории и ходов-убийц и ожидаемый ход соперника
+    // Таблица транспозиций не очищается, ее записи остаются верными для любой партии
+    void new_game()
+    {
+        history.assign(Rules::SQUARES * Rules::SQUARES, 0);
+        killers.assign(killers.size(), {-1, -1});
+        last_root = 0;
+        last_root_hash = 0;
+        expected_hash = {0, 0};
+        expected_move = {-1, -1};
     }
 
     // Поиск лучшей последовательности ходов для текущего игрока
@@ -49,36 +177,347 @@ class Logic
     // Возвращает вектор ходов, которые нужно сделать (может быть несколько при серии взятий)
     vector<move_pos> find_best_turns(const bool color)
     {
-        next_best_state.clear();
-        next_move.clear();
+        auto mtx = board->get_board();
+        Arena::Scope scope(*arena);
+        arena->reset();
+        load_history(board->move_history(), mtx, color);
+        return find_best_turns_root(mtx, color);
+    }
 
-        find_first_best_turn(board->get_board(), color, -1, -1, 0);
+    // Поиск лучшей последовательности ходов из произвольной позиции (без истории партии)
+    // Параметры:
+    // mtx - позиция, в которой ищется ход
+    // color - цвет игрока, который делает ход (true - черные, false - белые)
+    vector<move_pos> find_best_turns(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        Arena::Scope scope(*arena);
+        arena->reset();
+        load_history({}, mtx, color);
+        return find_best_turns_root(mtx, color);
+    }
 
-        int cur_state = 0;
-        vector<move_pos> res;
-        do
+    // Поиск лучшего хода итеративным углублением: глубина увеличивается на 1, пока не исчерпаны
+    // ограничения limits или не выставлен флаг stop_flag. Незавершенная итерация отбрасывается,
+    // если лучший ход предыдущей итерации еще не был пересмотрен
+    // Параметры:
+    // mtx - позиция, в которой ищется ход
+    // color - цвет игрока, который делает ход (true - черные, false - белые)
+    // game_history - позиции после полных ходов партии, заканчивающиеся текущей (может быть пустой)
+    // limits - ограничения поиска
+    // on_iteration - вызывается после каждой завершенной итерации
+    // Возвращает информацию о последней завершенной итерации (best пуст, если ходов нет)
+    search_info search(const vector<vector<POS_T>> &mtx, const bool color,
+                       const vector<vector<vector<POS_T>>> &game_history, const search_limits &limits,
+                       const function<void(const search_info &)> &on_iteration = nullptr)
+    {
+        begin_search(mtx, color, game_history, limits);
+        while (search_step(on_iteration))
         {
-            res.push_back(next_move[cur_state]);
-            cur_state = next_best_state[cur_state];
-        } while (cur_state != -1 && next_move[cur_state].x != -1);
-        return res;
+        }
+        return end_search();
+    }
+
+    // Пошаговый поиск - тот же поиск, что search, разделенный на итерации углубления
+    // (планировщик, см. Scheduler.h, кроме того приостанавливает поиск внутри итерации через on_yield):
+    // begin_search готовит корень, каждый search_step выполняет одну итерацию (on_iteration
+    // вызывается после нее, как в search) и возвращает false, когда поиск закончен,
+    // end_search возвращает результат. Шаги могут выполняться в разных потоках, но не одновременно,
+    // и до end_search экземпляр нельзя использовать для других поисков
+    void begin_search(const vector<vector<POS_T>> &mtx, const bool color,
+                      const vector<vector<vector<POS_T>>> &game_history, const search_limits &limits)
+    {
+        step.start = chrono::steady_clock::now();
+        Arena::Scope scope(*arena);
+        arena->reset();
+        load_history(game_history, mtx, color);
+        nodes = 0;
+        aborted = false;
+        max_nodes = limits.nodes;
+        start_search();
+        deadline = limits.time_ms ? step.start + chrono::milliseconds(limits.time_ms)
+                                  : chrono::steady_clock::time_point::max();
+
+        step.info = search_info();
+        step.mtx = mtx;
+        step.color = color;
+        // Корневые ходы живут в арене до следующего поиска, шаги добавляют свои данные после них
+        step.chains = search_chains();
+        generate_chains(color, mtx, step.chains);
+        step.depth = 0;
+        step.max_depth = limits.depth ? limits.depth : 64;
+        step.done = step.chains.empty();
+        if (step.done)
+            return;
+        Max_depth = 0;
+        prepare_tables();
+        if (opt_level >= 2)
+            order_chains(step.chains, mtx, 0);
+        put_expected_first(step.chains, color);
+    }
+
+    // Одна итерация пошагового поиска. Возвращает true, если поиск нужно продолжить
+    bool search_step(const function<void(const search_info &)> &on_iteration = nullptr)
+    {
+        if (step.done)
+            return false;
+        Arena::Scope scope(*arena);
+        auto &chains = step.chains;
+        search_info &info = step.info;
+        const int depth = step.depth++;
+        Max_depth = depth;
+        const size_t best = use_mtdf() ? search_mtdf(step.mtx, step.color, chains, info.score)
+                                       : search_root(step.mtx, step.color, chains);
+        step.done = true;
+        // Итерация прервана до того, как рассмотрен лучший ход предыдущей итерации
+        if (aborted && !root_complete)
+            return false;
+        info.depth = depth;
+        info.score = last_score;
+        info.best.assign(chains[best].path.begin(), chains[best].path.end());
+        info.nodes = nodes;
+        info.time_ms =
+            chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - step.start).count();
+        if (aborted)
+        {
+            // Остальные ходы в прерванной итерации не оценивались, строки предыдущей итерации устарели
+            if (multi_pv > 1)
+                info.lines.assign(1, search_line{info.score, info.best});
+            return false;
+        }
+        size_t first = best;
+        if (multi_pv > 1)
+        {
+            first = search_lines(chains, best);
+            if (aborted)
+                return false;
+        }
+        if (on_iteration)
+            on_iteration(info);
+        // Лучший ход ищется первым на следующей итерации
+        rotate(chains.begin(), chains.begin() + first, chains.begin() + first + 1);
+        // Найден форсированный выигрыш или проигрыш - углубляться дальше бессмысленно
+        if (abs(last_score) > INF / 2)
+            return false;
+        step.done = step.depth > step.max_depth;
+        return !step.done;
+    }
+
+    // Результат пошагового поиска (информация о последней завершенной итерации)
+    search_info end_search()
+    {
+        max_nodes = 0;
+        deadline = chrono::steady_clock::time_point::max();
+        step.done = true;
+        const auto &best = step.info.best;
+        const auto it = find_if(step.chains.begin(), step.chains.end(), [&best](const search_chain &chain) {
+            return equal(chain.path.begin(), chain.path.end(), best.begin(), best.end());
+        });
+        if (it != step.chains.end())
+            remember_reply(step.mtx, step.color, *it);
+        return std::move(step.info);
     }
 
 private:
-    // Выполняет ход на виртуальной доске и возвращает новое состояние
+    // Оценки следующих по силе ходов корня для multi-PV на глубине текущей итерации: каждый следующий
+    // ход - лучший среди ходов, еще не попавших в список, поэтому оценки точные, а не границы
+    // Отсечения с сокращением глубины зависят от порядка ходов, и ход, найденный позже, может получить
+    // оценку выше лучшего хода итерации - тогда строки переупорядочиваются и лучшим становится он
+    // Параметр best - индекс лучшего хода итерации в chains (его оценка в last_score)
+    // Возвращает индекс лучшего хода в chains после переупорядочивания
+    // Прерванный поиск оставляет уже найденные строки итерации
+    size_t search_lines(const search_chains &chains, const size_t best)
+    {
+        search_info &info = step.info;
+        vector<size_t> found{best};  // Индексы ходов строк в chains
+        vector<int> scores{last_score};
+        search_chains rest;
+        vector<size_t> rest_index;
+        for (size_t i = 0; i < chains.size(); ++i)
+        {
+            if (i == best)
+                continue;
+            rest.push_back(chains[i]);
+            rest_index.push_back(i);
+        }
+        while (found.size() < size_t(multi_pv) && !rest.empty())
+        {
+            const size_t next = search_root(step.mtx, step.color, rest);
+            if (aborted)
+                break;
+            found.push_back(rest_index[next]);
+            scores.push_back(last_score);
+            rest.erase(rest.begin() + next);
+            rest_index.erase(rest_index.begin() + next);
+        }
+        vector<size_t> order(found.size());
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&scores](const size_t a, const size_t b) { return scores[a] > scores[b]; });
+        info.lines.clear();
+        for (const size_t k : order)
+            info.lines.push_back(
+                search_line{scores[k], vector<move_pos>(chains[found[k]].path.begin(), chains[found[k]].path.end())});
+        info.score = last_score = info.lines[0].score;
+        info.best = info.lines[0].move;
+        info.nodes = nodes;
+        info.time_ms =
+            chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - step.start).count();
+        return found[order[0]];
+    }
+
+    // Корень поиска лучшего хода
     // Параметры:
     // mtx - текущее состояние доски
-    // turn - ход, который нужно выполнить
-    // Возвращает новое состояние доски после выполнения хода
-    vector<vector<POS_T>> make_turn(vector<vector<POS_T>> mtx, move_pos turn) const
+    // color - цвет игрока, который делает ход (true - черные, false - белые)
+    // Возвращает последовательность шагов лучшего полного хода
+    vector<move_pos> find_best_turns_root(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        nodes = 0;
+        aborted = false;
+        start_search();
+        search_chains chains;
+        generate_chains(color, mtx, chains);
+        prepare_tables();
+        if (opt_level >= 2)
+            order_chains(chains, mtx, 0);
+        put_expected_first(chains, color);
+        size_t best;
+        if (use_mtdf())
+        {
+            // MTD(f) нуждается в хорошем первом приближении, поэтому глубина Max_depth
+            // достигается итеративным углублением от оценки предыдущей глубины
+            const int target_depth = Max_depth;
+            int guess = 0;
+            for (Max_depth = 0; Max_depth <= target_depth; ++Max_depth)
+            {
+                best = search_mtdf(mtx, color, chains, guess);
+                guess = last_score;
+                rotate(chains.begin(), chains.begin() + best, chains.begin() + best + 1);
+            }
+            Max_depth = target_depth;
+            best = 0;
+        }
+        else
+            best = search_root(mtx, color, chains);
+        const auto &path = chains[best].path;
+        remember_reply(mtx, color, chains[best]);
+        return vector<move_pos>(path.begin(), path.end());
+    }
+
+    // Перебор полных ходов в корне поиска на глубину Max_depth
+    // Параметры:
+    // mtx - текущее состояние доски
+    // color - цвет игрока, который делает ход (true - черные, false - белые)
+    // chains - полные ходы в порядке перебора
+    // alpha, beta - окно поиска (по умолчанию полное); перебор прекращается, как только ход достиг beta
+    // Возвращает индекс лучшего хода в chains, оценка сохраняется в last_score
+    // (вне окна - граница оценки, как и в find_best_turns_rec)
+    // При прерывании поиска root_complete показывает, успел ли рассмотреться первый ход
+    size_t search_root(const vector<vector<POS_T>> &mtx, const bool color, const search_chains &chains,
+                       int alpha = -INF - 1, const int beta = INF + 1)
+    {
+        prepare_tables();
+        root_complete = false;
+
+        // Корень поиска: каждый полный ход (включая всю серию взятий) рассматривается как один ход
+        int best_score = -INF - 1;
+        size_t best_chain = 0;
+        auto &next_mtx = ply_boards[0];
+        if (nnue)
+            nnue->refresh(mtx, accumulators[0]);
+        for (size_t i = 0; i < chains.size(); ++i)
+        {
+            next_mtx = mtx;
+            apply_chain(next_mtx, chains[i]);
+            if (nnue)
+                update_accumulator(mtx, chains[i], 0);
+            const size_t saved_from = push_position(mtx, next_mtx, chains[i]);
+            int score;
+            if (i == 0 || opt_level < 2)
+            {
+                score = -find_best_turns_rec(next_mtx, 1 - color, Max_depth, 1, -beta, -alpha);
+            }
+            else
+            {
+                // Поиск с нулевым окном: проверяем, что ход не хуже уже найденного
+                score = -find_best_turns_rec(next_mtx, 1 - color, Max_depth, 1, -alpha - 1, -alpha);
+                if (score > alpha)
+                    score = -find_best_turns_rec(next_mtx, 1 - color, Max_depth, 1, -beta, -alpha);
+            }
+            pop_position(saved_from);
+            if (aborted)
+                break;
+            root_complete = true;
+            if (score > best_score)
+            {
+                best_score = score;
+                best_chain = i;
+            }
+            if (opt_level >= 1)
+            {
+                alpha = max(alpha, best_score);
+                if (alpha >= beta)
+                    break;
+            }
+        }
+        last_score = best_score;
+        return best_chain;
+    }
+
+    // Используется ли MTD(f): суффикс "-MTDF" уровня оптимизации, альфа-бета отсечение
+    // и таблица транспозиций, без которой каждый поиск с нулевым окном начинался бы заново
+    bool use_mtdf() const
+    {
+        return mtdf && opt_level >= 1 && tt;
+    }
+
+    // MTD(f) в корне на глубину Max_depth: поиски с нулевым окном сужают границы оценки, начиная
+    // с приближения guess, пока нижняя и верхняя границы не сойдутся
+    // Лучший ход - ход, достигший beta в последнем поиске с повышением нижней границы: его оценка
+    // не меньше итоговой. Такой ход переносится в начало chains и перебирается первым в следующих поисках
+    // Возвращает индекс лучшего хода в chains, оценка сохраняется в last_score
+    // Прерванный поиск не дает надежного хода, поэтому root_complete при прерывании сбрасывается
+    // С поиском с полным окном оценка совпадает только без таблицы транспозиций: поиски с нулевым окном
+    // берут из таблицы границы, найденные с другими окнами и на большей глубине, и оценки, зависящие
+    // от пути (повторения). В bench на глубине 9 с "O1" и таблицей 16 МБ оценки расходятся в 1 позиции
+    // из 50 (на глубине 8 - в 1, на 10 - в 3), так же изредка расходятся "O1" с таблицей и без нее
+    size_t search_mtdf(const vector<vector<POS_T>> &mtx, const bool color, search_chains &chains, const int guess)
+    {
+        int lower = -INF - 1, upper = INF + 1;
+        int score = guess;
+        while (lower < upper)
+        {
+            const int beta = max(score, lower + 1);
+            const size_t best = search_root(mtx, color, chains, beta - 1, beta);
+            if (aborted)
+            {
+                root_complete = false;
+                return 0;
+            }
+            score = last_score;
+            if (score < beta)
+                upper = score;
+            else
+            {
+                lower = score;
+                rotate(chains.begin(), chains.begin() + best, chains.begin() + best + 1);
+            }
+        }
+        last_score = score;
+        return 0;
+    }
+
+    // Выполняет один шаг хода на месте
+    // Параметр promote - превращать ли шашку, дошедшую до последней строки (в вариантах без превращения
+    // во время взятия шашка превращается только на последнем шаге хода)
+    void apply_turn(vector<vector<POS_T>> &mtx, const move_pos &turn, const bool promote = true) const
     {
         if (turn.xb != -1)
             mtx[turn.xb][turn.yb] = 0;
-        if ((mtx[turn.x][turn.y] == 1 && turn.x2 == 0) || (mtx[turn.x][turn.y] == 2 && turn.x2 == 7))
+        const POS_T type = mtx[turn.x][turn.y];
+        if (promote && type <= 2 && turn.x2 == Rules::promotion_row(type))
             mtx[turn.x][turn.y] += 2;
         mtx[turn.x2][turn.y2] = mtx[turn.x][turn.y];
         mtx[turn.x][turn.y] = 0;
-        return mtx;
     }
 
     // Вычисляет оценку текущей позиции для бота
@@ -91,149 +530,811 @@ private:
     // - 0 означает поражение бота
     double calc_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color) const
     {
-        // Цвет игрока, для которого максимизируем оценку
-        double w = 0, wq = 0, b = 0, bq = 0;
-        for (POS_T i = 0; i < 8; ++i)
-        {
-            for (POS_T j = 0; j < 8; ++j)
-            {
-                w += (mtx[i][j] == 1);
-                wq += (mtx[i][j] == 3);
-                b += (mtx[i][j] == 2);
-                bq += (mtx[i][j] == 4);
-                if (scoring_mode == "NumberAndPotential")
-                {
-                    w += 0.05 * (mtx[i][j] == 1) * (7 - i);
-                    b += 0.05 * (mtx[i][j] == 2) * (i);
-                }
-            }
-        }
-        if (!first_bot_color)
-        {
-            swap(b, w);
-            swap(bq, wq);
-        }
-        if (w + wq == 0)
+        return material_ratio(BatchEval::count_scalar(BatchEval::pack(mtx)), first_bot_color);
+    }
+
+    // Отношение материала игрока color к материалу соперника (см. calc_score)
+    // В режиме "NumberAndPotential" материал считается по весам weights (по умолчанию шашка стоит 1
+    // плюс 0.05 за каждую пройденную строку, дамка - 5), в режиме "Number" шашка - 1, дамка - 4.
+    // Материал считается в целых единицах, поэтому отношение не зависит от порядка сложения
+    double material_ratio(const typename BatchEval::Material &m, const bool color) const
+    {
+        const int me = color ? 1 : 0, op = 1 - me;
+        if (m.men[op] + m.kings[op] == 0)
             return INF;
-        if (b + bq == 0)
+        if (m.men[me] + m.kings[me] == 0)
             return 0;
-        int q_coef = 4;
-        if (scoring_mode == "NumberAndPotential")
-        {
-            q_coef = 5;
-        }
-        return (b + bq * q_coef) / (w + wq * q_coef);
+        if (potential_scoring)
+            return double(weights.man * m.men[me] + weights.advance * m.rows[me] + weights.king * m.kings[me]) /
+                   (weights.man * m.men[op] + weights.advance * m.rows[op] + weights.king * m.kings[op]);
+        return double(m.men[me] + 4 * m.kings[me]) / (m.men[op] + 4 * m.kings[op]);
+    }
+
+    // Переводит оценку calc_score в целочисленную оценку с точки зрения игрока color
+    // Отношение r материала игрока к материалу соперника переводится в (r - 1) / (r + 1),
+    // поэтому оценка соперника равна оценке игрока с обратным знаком
+    // Параметры:
+    // mtx - текущее состояние доски
+    // color - цвет игрока, с чьей точки зрения оценивается позиция
+    // ply - расстояние от корня поиска (более быстрый выигрыш оценивается выше)
+    // В режиме "NNUE" позиция оценивается по накопителю уровня ply (доска не просматривается)
+    int evaluate(const vector<vector<POS_T>> &mtx, const bool color, const int ply) const
+    {
+        if (nnue)
+            return nnue_score(accumulators[ply], color, ply);
+        return ratio_to_score(calc_score(mtx, color), ply);
+    }
+
+    // Оценка нейросети по накопителю acc с точки зрения игрока color
+    // Позиция без фигур - выигрыш или проигрыш, иначе оценка ограничивается (-SCORE_SCALE, SCORE_SCALE)
+    int nnue_score(const Nnue::Accumulator &acc, const bool color, const int ply) const
+    {
+        const int me = color ? 1 : 0;
+        if (acc.pieces[1 - me] == 0)
+            return INF - ply;
+        if (acc.pieces[me] == 0)
+            return -(INF - ply);
+        return max(-(SCORE_SCALE - 1), min(SCORE_SCALE - 1, nnue->evaluate(acc, color)));
+    }
+
+    // Накопитель позиции после хода chain из позиции mtx уровня ply (записывается на уровень ply + 1)
+    void update_accumulator(const vector<vector<POS_T>> &mtx, const search_chain &chain, const int ply)
+    {
+        nnue->update(accumulators[ply], mtx, chain, final_type(mtx, chain), accumulators[ply + 1]);
+    }
+
+    // Переводит отношение материала в целочисленную оценку (см. evaluate)
+    static int ratio_to_score(const double ratio, const int ply)
+    {
+        if (ratio >= INF)
+            return INF - ply;
+        if (ratio <= 0)
+            return -(INF - ply);
+        return int(lround(SCORE_SCALE * (ratio - 1) / (ratio + 1)));
     }
 
-    // Рекурсивно ищет лучший первый ход и все последующие ходы в серии взятий
+    // Рекурсивно ищет лучший ход (негамакс с альфа-бета отсечением)
+    // Каждый полный ход (вся серия взятий) перебирается как один ход, поэтому
+    // серии взятий не требуют отдельной обработки
     // Параметры:
     // mtx - текущее состояние доски
     // color - цвет игрока, который делает ход (true - черные, false - белые)
-    // x, y - координаты шашки, которой нужно сделать следующий ход в серии взятий
-    // state - индекс текущего состояния в векторах next_move и next_best_state
-    // alpha - лучшая оценка, найденная на данный момент (для альфа-бета отсечения)
-    // Возвращает оценку лучшего найденного хода
-    double find_first_best_turn(vector<vector<POS_T>> mtx, const bool color, const POS_T x, const POS_T y, size_t state,
-                                double alpha = -1)
+    // depth - оставшаяся глубина поиска
+    // ply - расстояние от корня поиска
+    // alpha - нижняя граница оценки (для альфа-бета отсечения)
+    // beta - верхняя граница оценки (для альфа-бета отсечения)
+    // Возвращает оценку позиции с точки зрения игрока color
+    int find_best_turns_rec(const vector<vector<POS_T>> &mtx, const bool color, int depth, const int ply,
+                            int alpha, const int beta)
     {
-        next_best_state.push_back(-1);
-        next_move.emplace_back(-1, -1, -1, -1);
-        double best_score = -1;
-        if (state != 0)
-            find_turns(x, y, mtx);
-        auto turns_now = turns;
-        bool have_beats_now = have_beats;
+        // Проверка ограничений поиска раз в 1024 позиции
+        if ((++nodes & 1023) == 0 && out_of_limits())
+            aborted = true;
+        if (aborted)
+            return 0;
+        // Повторение позиции - ничья
+        if (is_repetition())
+            return 0;
+        if (depth <= 0)
+        {
+            return add_noise(evaluate(mtx, color, ply));
+        }
+        // Список ходов и другие временные данные позиции освобождаются в арене при выходе
+        Arena::Rewind rewind;
+        search_chains chains;
+        generate_chains(color, mtx, chains);
+
+        if (chains.empty())
+            return -(INF - ply);
 
-        if (!have_beats_now && state != 0)
+        // Таблица транспозиций: готовая оценка или лучший ход для сортировки
+        const uint64_t tt_key = position_hashes.back() ^ tt_salt ^ noise_seed;
+        const int alpha_orig = alpha;
+        int tt_move = -1;
+        TransTable::Entry entry;
+        if (tt && tt->probe(tt_key, entry))
         {
-            return find_best_turns_rec(mtx, 1 - color, 0, alpha);
+            tt_move = entry.move;
+            const int tt_score = score_from_tt(entry.score, ply);
+            if (entry.depth >= depth &&
+                (entry.bound == TransTable::EXACT || (entry.bound == TransTable::LOWER && tt_score >= beta) ||
+                 (entry.bound == TransTable::UPPER && tt_score <= alpha)))
+                return tt_score;
         }
 
-        vector<move_pos> best_moves;
-        vector<int> best_states;
+        // Выборочные методы применяются только в тихих позициях (без обязательного взятия)
+        // и вне зоны найденного выигрыша
+        const bool selective = opt_level >= 3 && !have_beats && abs(beta) < SCORE_SCALE;
+        const int static_score = selective ? evaluate(mtx, color, ply) : 0;
 
-        for (auto turn : turns_now)
+        // Razoring: на предпоследнем уровне безнадежная позиция ищется на один уровень меньше
+        if (selective && depth == 2 && static_score + RAZOR_MARGIN <= alpha)
+            depth = 1;
+
+        // ProbCut: если неглубокий поиск уверенно превышает beta, то и полный поиск скорее всего превысит
+        if (opt_level >= 4 && !have_beats && depth >= PROBCUT_DEPTH && abs(beta) < SCORE_SCALE)
+        {
+            const int rbeta = beta + PROBCUT_MARGIN;
+            int score = find_best_turns_rec(mtx, color, depth - PROBCUT_REDUCTION, ply, rbeta - 1, rbeta);
+            if (score >= rbeta)
+                return score;
+        }
+
+        if (opt_level >= 2)
+            order_chains(chains, mtx, ply);
+        // Лучший ход из таблицы транспозиций перебирается первым
+        if (tt_move != -1)
         {
-            size_t next_state = next_move.size();
-            double score;
-            if (have_beats_now)
+            auto it = find_if(chains.begin(), chains.end(),
+                              [tt_move](const search_chain &chain) { return chain_code(chain) == tt_move; });
+            if (it != chains.end())
+                rotate(chains.begin(), it, it + 1);
+        }
+
+        // На предпоследнем уровне потомки - листья: их оценки считаются одним пакетом
+        arena_vector<int> leaf_scores;
+        if (depth == 1 && batch_leaves)
+            leaf_scores = evaluate_children(mtx, color, chains, ply + 1);
+
+        int best_score = -INF - 1;
+        int best_move = -1;
+        auto &next_mtx = ply_boards[ply];
+        for (size_t i = 0; i < chains.size(); ++i)
+        {
+            const auto &chain = chains[i];
+            // Поиск в позиции после хода (для листа - готовая оценка из пакета)
+            auto search_child = [&](const int child_depth, const int child_alpha, const int child_beta) {
+                if (child_depth <= 0 && !leaf_scores.empty())
+                    return leaf(leaf_scores[i]);
+                return find_best_turns_rec(next_mtx, 1 - color, child_depth, ply + 1, child_alpha, child_beta);
+            };
+            // Взятия и превращения в дамку не сокращаются и не отсекаются
+            const bool tactical = chain.is_beat() || promotes(mtx, chain);
+
+            // Futility pruning: тихий ход у листа не спасет позицию, которая сильно хуже alpha
+            if (selective && depth == 1 && i > 0 && !tactical && static_score + FUTILITY_MARGIN <= alpha)
+            {
+                best_score = max(best_score, static_score + FUTILITY_MARGIN);
+                continue;
+            }
+
+            next_mtx = mtx;
+            apply_chain(next_mtx, chain);
+            // Потомкам с готовой оценкой из пакета накопитель не нужен
+            if (nnue && leaf_scores.empty())
+                update_accumulator(mtx, chain, ply);
+            const size_t saved_from = push_position(mtx, next_mtx, chain);
+            int score;
+            if (i == 0 || opt_level < 2)
             {
-                score = find_first_best_turn(make_turn(mtx, turn), color, turn.x2, turn.y2, next_state, best_score);
+                score = -search_child(depth - 1, -beta, -alpha);
             }
             else
             {
-                score = find_best_turns_rec(make_turn(mtx, turn), 1 - color, 0, best_score);
+                // LMR: поздние тихие ходы сначала ищутся на меньшую глубину
+                int reduction = (depth >= LMR_DEPTH && i >= LMR_MOVE_NUM && !tactical &&
+                                 !is_killer(chain, ply)) ? 1 : 0;
+                score = -search_child(depth - 1 - reduction, -alpha - 1, -alpha);
+                if (score > alpha && reduction)
+                    score = -search_child(depth - 1, -alpha - 1, -alpha);
+                // Перепоиск с полным окном, если ход оказался лучше ожидаемого
+                if (score > alpha && score < beta)
+                    score = -search_child(depth - 1, -beta, -alpha);
             }
+            pop_position(saved_from);
+            if (aborted)
+                return 0;
             if (score > best_score)
             {
                 best_score = score;
-                next_best_state[state] = (have_beats_now ? int(next_state) : -1);
-                next_move[state] = turn;
+                best_move = chain_code(chain);
             }
+            // alpha-beta pruning
+            if (opt_level >= 1)
+            {
+                alpha = max(alpha, score);
+                if (alpha >= beta)
+                {
+                    if (!tactical)
+                        remember_cutoff(chain, depth, ply);
+                    break;
+                }
+            }
+        }
+        if (tt)
+        {
+            const auto bound = best_score >= beta         ? TransTable::LOWER
+                               : best_score <= alpha_orig ? TransTable::UPPER
+                                                          : TransTable::EXACT;
+            tt->store(tt_key, score_to_tt(best_score, ply), depth, bound, best_move);
         }
         return best_score;
     }
 
-    // Рекурсивно ищет лучший ход с использованием минимакса и альфа-бета отсечения
+    // Лист с готовой оценкой score: то же, что find_best_turns_rec при depth <= 0
+    // (учет позиции в nodes, проверка ограничений и повторения)
+    int leaf(const int score)
+    {
+        if ((++nodes & 1023) == 0 && out_of_limits())
+            aborted = true;
+        if (aborted || is_repetition())
+            return 0;
+        return add_noise(score);
+    }
+
+    // Подготовка к новому поиску с сохранением знаний прошлых поисков
+    // Записи таблицы транспозиций стареют. Если поиск продолжает партию прошлого поиска (корень прошлого
+    // поиска есть в истории на том же месте), бонусы таблицы истории уменьшаются вдвое, а ходы-убийцы
+    // сдвигаются на число ходов, сделанных с прошлого поиска (уровень ply прошлого поиска становится
+    // уровнем ply - shift нового). Для несвязанной позиции они сбрасываются: чужой порядок ходов сбивает
+    // окна поиска, и записи таблицы транспозиций с границами оценки перестают давать отсечения
+    void start_search()
+    {
+        if (tt)
+            tt->new_search();
+        const size_t root = position_hashes.size() - 1;
+        const bool same_game = root > last_root && position_hashes[last_root] == last_root_hash;
+        for (auto &bonus : history)
+            bonus = same_game ? bonus / 2 : 0;
+        const size_t shift = same_game ? root - last_root : killers.size();
+        for (size_t ply = 0; ply < killers.size(); ++ply)
+            killers[ply] = ply + shift < killers.size() ? killers[ply + shift] : array<int, 2>{-1, -1};
+        last_root = root;
+        last_root_hash = position_hashes[root];
+        new_noise_seed();
+    }
+
+    // Если текущая позиция - ожидаемая после прошлого поиска (соперник сделал предсказанный ответ),
+    // лучший ход из главного варианта прошлого поиска перебирается первым
+    void put_expected_first(search_chains &chains, const bool color)
+    {
+        if (expected_move[color] == -1 || position_hashes.back() != expected_hash[color])
+            return;
+        for (size_t i = 0; i < chains.size(); ++i)
+        {
+            if (chain_code(chains[i]) == expected_move[color])
+            {
+                rotate(chains.begin(), chains.begin() + i, chains.begin() + i + 1);
+                ++predicted_hits;
+                return;
+            }
+        }
+    }
+
+    // Запоминает позицию, ожидаемую к следующему поиску, и лучший ход в ней по главному варианту
+    // из таблицы транспозиций: после хода best ожидается лучший ответ соперника
+    // Вызывается после поиска: хеш корня - последний в истории хешей, доски строятся на досках
+    // уровней, ходы соперника - в арене, поэтому куча не используется
+    // Без таблицы транспозиций или без ее записей ожидание сбрасывается
+    void remember_reply(const vector<vector<POS_T>> &mtx, const bool color, const search_chain &best)
+    {
+        expected_move[color] = -1;
+        expected_hash[color] = 0;
+        if (!tt)
+            return;
+        Arena::Scope scope(*arena);
+        Arena::Rewind rewind;
+        auto &child = ply_boards[0];
+        child = mtx;
+        apply_chain(child, best);
+        const uint64_t child_hash = Zobrist::update(position_hashes.back(), mtx, child, best);
+        TransTable::Entry entry;
+        if (!tt->probe(child_hash ^ tt_salt ^ noise_seed, entry) || entry.move == -1)
+            return;
+        search_chains replies;
+        generate_chains(!color, child, replies);
+        for (const auto &reply : replies)
+        {
+            if (chain_code(reply) != entry.move)
+                continue;
+            auto &grandchild = ply_boards[1];
+            grandchild = child;
+            apply_chain(grandchild, reply);
+            expected_hash[color] = Zobrist::update(child_hash, child, grandchild, reply);
+            if (tt->probe(expected_hash[color] ^ tt_salt ^ noise_seed, entry))
+                expected_move[color] = entry.move;
+            return;
+        }
+    }
+
+    // Выбор новой случайной добавки к оценкам в начале каждого поиска
+    // (без случайности добавка всегда одна и та же)
+    void new_noise_seed()
+    {
+        noise_seed = (eval_noise && !no_random) ? uint64_t(rand_eng()) << 32 | rand_eng() : 0;
+    }
+
+    // Добавка к оценке листа для ослабления бота (см. eval_noise)
+    // Добавка зависит только от позиции (хеша) и зерна noise_seed, поэтому внутри одного поиска
+    // одна и та же позиция всегда оценивается одинаково. Выигрыш и проигрыш не меняются
+    int add_noise(const int score) const
+    {
+        if (!eval_noise || abs(score) >= SCORE_SCALE)
+            return score;
+        const uint64_t h = (position_hashes.back() ^ noise_seed) * 0x9E3779B97F4A7C15ull;
+        const int noise = int((h >> 32) % uint64_t(2 * eval_noise + 1)) - eval_noise;
+        return max(-(SCORE_SCALE - 1), min(SCORE_SCALE - 1, score + noise));
+    }
+
+    // Оценки позиций после каждого хода из chains с точки зрения соперника color
+    // Позиции потомков получаются из упакованной позиции mtx изменением нескольких битов,
+    // а материал всех потомков считается одним пакетом (см. BatchEval)
+    // В режиме "NNUE" каждый потомок оценивается по накопителю, полученному из накопителя mtx
+    arena_vector<int> evaluate_children(const vector<vector<POS_T>> &mtx, const bool color,
+                                        const search_chains &chains, const int ply) const
+    {
+        if (nnue)
+        {
+            arena_vector<int> scores(chains.size());
+            Nnue::Accumulator child;
+            for (size_t i = 0; i < chains.size(); ++i)
+            {
+                nnue->update(accumulators[ply - 1], mtx, chains[i], final_type(mtx, chains[i]), child);
+                scores[i] = nnue_score(child, !color, ply);
+            }
+            return scores;
+        }
+        const auto parent = BatchEval::pack(mtx);
+        arena_vector<typename BatchEval::Packed> packed;
+        packed.reserve(chains.size());
+        for (const auto &chain : chains)
+            packed.push_back(BatchEval::after(parent, mtx, chain, final_type(mtx, chain)));
+        arena_vector<typename BatchEval::Material> material(chains.size());
+        BatchEval::count(packed.data(), packed.size(), material.data());
+        arena_vector<int> scores(chains.size());
+        for (size_t i = 0; i < chains.size(); ++i)
+            scores[i] = ratio_to_score(material_ratio(material[i], !color), ply);
+        return scores;
+    }
+
+    // Оценка выигрыша зависит от расстояния до корня, поэтому в таблице транспозиций
+    // она хранится относительно текущей позиции
+    static int score_to_tt(const int score, const int ply)
+    {
+        return score > INF / 2 ? score + ply : score < -INF / 2 ? score - ply : score;
+    }
+
+    static int score_from_tt(const int score, const int ply)
+    {
+        return score > INF / 2 ? score - ply : score < -INF / 2 ? score + ply : score;
+    }
+
+    // Готовит таблицы ходов-убийц и буферы досок (на глубину Max_depth) и таблицу истории
+    // Таблицы и буферы только растут: ссылки на доски остаются верными во время поиска,
+    // а ходы-убийцы сохраняются между итерациями и поисками (см. start_search)
+    void prepare_tables()
+    {
+        if (killers.size() < size_t(Max_depth + 2))
+            killers.resize(Max_depth + 2, {-1, -1});
+        if (ply_boards.size() < size_t(Max_depth + 2))
+            ply_boards.resize(Max_depth + 2, empty_board());
+        if (nnue && accumulators.size() < size_t(Max_depth + 3))
+            accumulators.resize(Max_depth + 3);
+        if (history.empty())
+            history.assign(Rules::SQUARES * Rules::SQUARES, 0);
+    }
+
+    // Проверяет, исчерпаны ли ограничения поиска (флаг остановки, число позиций, время)
+    bool out_of_limits() const
+    {
+        if (on_yield)
+            on_yield();
+        return (stop_flag && stop_flag->load(memory_order_relaxed)) || (max_nodes && nodes >= max_nodes) ||
+               chrono::steady_clock::now() >= deadline;
+    }
+
+    // Заполняет историю хешей позиций партии
     // Параметры:
-    // mtx - текущее состояние доски
-    // color - цвет игрока, который делает ход (true - черные, false - белые)
-    // depth - текущая глубина рекурсии
-    // alpha - нижняя граница оценки (для альфа-бета отсечения)
-    // beta - верхняя граница оценки (для альфа-бета отсечения)
-    // x, y - координаты шашки, которой нужно сделать следующий ход в серии взятий
-    // Возвращает оценку лучшего найденного хода
-    double find_best_turns_rec(vector<vector<POS_T>> mtx, const bool color, const size_t depth, double alpha = -1,
-                               double beta = INF + 1, const POS_T x = -1, const POS_T y = -1)
+    // history - позиции после полных ходов партии (Board::move_history), очередь хода в них
+    // чередуется и в последней позиции совпадает с color
+    // mtx - текущая позиция, с которой начинается поиск
+    // color - чей ход в текущей позиции
+    void load_history(const vector<vector<vector<POS_T>>> &history, const vector<vector<POS_T>> &mtx,
+                      const bool color)
     {
-        if (depth == Max_depth)
+        position_hashes.clear();
+        reversible_from = 0;
+        for (size_t i = 0; i < history.size(); ++i)
         {
-            return calc_score(mtx, (depth % 2 == color));
+            if (i > 0 && !is_reversible(history[i - 1], history[i]))
+                reversible_from = i;
+            position_hashes.push_back(Zobrist::hash(history[i], color ^ ((history.size() - 1 - i) % 2)));
         }
-        if (x != -1)
+        // Если история не заканчивается текущей позицией, начинаем новую
+        const uint64_t h = Zobrist::hash(mtx, color);
+        if (position_hashes.empty() || position_hashes.back() != h)
         {
-            find_turns(x, y, mtx);
+            position_hashes.assign(1, h);
+            reversible_from = 0;
         }
-        else
-            find_turns(color, mtx);
-        auto turns_now = turns;
-        bool have_beats_now = have_beats;
+    }
+
+    // Добавляет позицию после хода chain в историю хешей
+    // Возвращает прежнее начало окна обратимых ходов, которое нужно передать в pop_position
+    size_t push_position(const vector<vector<POS_T>> &mtx, const vector<vector<POS_T>> &next_mtx,
+                         const search_chain &chain)
+    {
+        const size_t saved_from = reversible_from;
+        // Взятие или ход простой шашки необратимы: прежние позиции больше не могут повториться
+        if (chain.is_beat() || mtx[chain.x()][chain.y()] <= 2)
+            reversible_from = position_hashes.size();
+        position_hashes.push_back(Zobrist::update(position_hashes.back(), mtx, next_mtx, chain));
+        return saved_from;
+    }
+
+    // Удаляет последнюю позицию из истории хешей
+    void pop_position(const size_t saved_from)
+    {
+        position_hashes.pop_back();
+        reversible_from = saved_from;
+    }
+
+    // Проверяет, встречалась ли последняя позиция раньше (с той же очередью хода)
+    bool is_repetition() const
+    {
+        const size_t last = position_hashes.size() - 1;
+        for (size_t i = last; i >= reversible_from + 2;)
+        {
+            i -= 2;
+            if (position_hashes[i] == position_hashes[last])
+                return true;
+        }
+        return false;
+    }
 
-        if (!have_beats_now && x != -1)
+    // Сортирует ходы: сначала взятия (по числу побитых шашек), затем превращения в дамку,
+    // ходы-убийцы текущего уровня и тихие ходы по таблице истории
+    // Сортировка устойчивая, поэтому случайный порядок равных ходов сохраняется
+    // Ходов немного, поэтому используется сортировка вставками: она не выделяет память
+    void order_chains(search_chains &chains, const vector<vector<POS_T>> &mtx, const int ply) const
+    {
+        arena_vector<int> keys;
+        keys.reserve(chains.size());
+        for (const auto &chain : chains)
         {
-            return find_best_turns_rec(mtx, 1 - color, depth + 1, alpha, beta);
+            int key = history[chain_code(chain)];
+            if (chain.is_beat())
+                key = INF / 4 * 3 + int(chain.captured.size());
+            else if (promotes(mtx, chain))
+                key = INF / 2;
+            else if (is_killer(chain, ply))
+                key = INF / 4 + (killers[ply][0] == chain_code(chain));
+            keys.push_back(key);
         }
+        for (size_t i = 1; i < chains.size(); ++i)
+        {
+            for (size_t j = i; j > 0 && keys[j - 1] < keys[j]; --j)
+            {
+                swap(keys[j - 1], keys[j]);
+                swap(chains[j - 1], chains[j]);
+            }
+        }
+    }
 
-        if (turns.empty())
-            return (depth % 2 ? 0 : INF);
+    // Запоминает тихий ход, вызвавший отсечение: ход-убийца уровня ply и бонус в таблице истории
+    void remember_cutoff(const search_chain &chain, const int depth, const int ply)
+    {
+        const int code = chain_code(chain);
+        history[code] = min(history[code] + depth * depth, INF / 8);
+        if (killers[ply][0] != code)
+        {
+            killers[ply][1] = killers[ply][0];
+            killers[ply][0] = code;
+        }
+    }
 
-        double min_score = INF + 1;
-        double max_score = -1;
-        for (auto turn : turns_now)
+    // Является ли ход ходом-убийцей на уровне ply
+    bool is_killer(const search_chain &chain, const int ply) const
+    {
+        const int code = chain_code(chain);
+        return killers[ply][0] == code || killers[ply][1] == code;
+    }
+
+    // Код хода по начальной и конечной клетке (индекс в таблице истории)
+    static int chain_code(const search_chain &chain)
+    {
+        return Rules::square(chain.x(), chain.y()) * Rules::SQUARES + Rules::square(chain.x2(), chain.y2());
+    }
+
+    // Пустая доска
+    static vector<vector<POS_T>> empty_board()
+    {
+        return vector<vector<POS_T>>(Rules::SIZE, vector<POS_T>(Rules::SIZE, 0));
+    }
+
+    // Превращается ли шашка в дамку за этот ход
+    bool promotes(const vector<vector<POS_T>> &mtx, const search_chain &chain) const
+    {
+        const POS_T type = mtx[chain.x()][chain.y()];
+        return type <= 2 && ends_as_queen(type, chain);
+    }
+
+    // Тип шашки в конце хода (с учетом превращения в дамку)
+    POS_T final_type(const vector<vector<POS_T>> &mtx, const search_chain &chain) const
+    {
+        const POS_T type = mtx[chain.x()][chain.y()];
+        return promotes(mtx, chain) ? type + 2 : type;
+    }
+
+    // Рекурсивно продолжает серию взятий и добавляет законченные цепочки в chains
+    // Параметры:
+    // mtx - доска после последнего шага цепочки
+    // occ - маска занятых клеток mtx
+    // type - тип шашки в начале хода
+    // chain - текущая цепочка
+    // chains - список законченных цепочек
+    void extend_chain(const vector<vector<POS_T>> &mtx, const Bits occ, const POS_T type, search_chain &chain,
+                      search_chains &chains)
+    {
+        find_turns(chain.x2(), chain.y2(), mtx, occ);
+        if (!have_beats)
+        {
+            add_chain(type, chain, chains);
+            return;
+        }
+        const arena_vector<move_pos> turns_now(turns.begin(), turns.end());
+        auto &next_mtx = chain_boards[chain.path.size()];
+        for (const auto &turn : turns_now)
+        {
+            next_mtx = mtx;
+            apply_turn(next_mtx, turn, Rules::PROMOTE_IN_CAPTURE);
+            chain.path.push_back(turn);
+            chain.captured.emplace_back(turn.xb, turn.yb);
+            extend_chain(next_mtx, occupancy_after(occ, turn), type, chain, chains);
+            chain.path.pop_back();
+            chain.captured.pop_back();
+        }
+    }
+
+    // Добавляет законченную цепочку, если хода с такой же итоговой позицией еще нет
+    // Итоговая позиция задается начальной и конечной клеткой, типом шашки в конце и набором побитых шашек
+    void add_chain(const POS_T type, const search_chain &chain, search_chains &chains) const
+    {
+        for (const auto &other : chains)
         {
-            double score = 0.0;
-            if (!have_beats_now && x == -1)
+            if (other.x() != chain.x() || other.y() != chain.y() || other.x2() != chain.x2() ||
+                other.y2() != chain.y2() || other.captured.size() != chain.captured.size())
+                continue;
+            // Шашка не может быть побита дважды, поэтому наборы совпадают, если каждая
+            // побитая шашка одного хода есть среди побитых другим
+            bool same = true;
+            for (size_t i = 0; same && i < chain.captured.size(); ++i)
+                same = find(other.captured.begin(), other.captured.end(), chain.captured[i]) != other.captured.end();
+            if (same && ends_as_queen(type, other) == ends_as_queen(type, chain))
+                return;
+        }
+        chains.push_back(chain);
+    }
+
+    // Проверяет, является ли шашка дамкой в конце хода
+    // Параметры:
+    // type - тип шашки в начале хода
+    // chain - полный ход
+    bool ends_as_queen(const POS_T type, const search_chain &chain) const
+    {
+        if (type > 2)
+            return true;
+        if (!Rules::PROMOTE_IN_CAPTURE)
+            return chain.x2() == Rules::promotion_row(type);
+        for (const auto &turn : chain.path)
+        {
+            if (turn.x2 == Rules::promotion_row(type))
+                return true;
+        }
+        return false;
+    }
+
+    // Находит все полные ходы для указанного цвета (см. find_chains) и записывает их в chains
+    // Внутри поиска ходы размещаются в арене
+    void generate_chains(const bool color, const vector<vector<POS_T>> &mtx, search_chains &chains)
+    {
+        find_turns(color, mtx);
+        if (!have_beats)
+        {
+            chains.reserve(turns.size());
+            for (const auto &turn : turns)
             {
-                score = find_best_turns_rec(make_turn(mtx, turn), 1 - color, depth + 1, alpha, beta);
+                chains.emplace_back();
+                chains.back().path.push_back(turn);
             }
-            else
+            return;
+        }
+        // При взятии продолжаем каждую цепочку, пока есть что бить
+        const arena_vector<move_pos> first_turns(turns.begin(), turns.end());
+        auto &next_mtx = chain_boards[0];
+        for (const auto &turn : first_turns)
+        {
+            next_mtx = mtx;
+            apply_turn(next_mtx, turn, Rules::PROMOTE_IN_CAPTURE);
+            search_chain chain;
+            chain.path.push_back(turn);
+            chain.captured.emplace_back(turn.xb, turn.yb);
+            extend_chain(next_mtx, occupancy_after(occupied, turn), mtx[turn.x][turn.y], chain, chains);
+        }
+        // Из нескольких взятий разрешены только взятия наибольшего числа шашек
+        if (Rules::MAX_CAPTURE)
+        {
+            size_t most = 0;
+            for (const auto &chain : chains)
+                most = max(most, chain.captured.size());
+            chains.erase(remove_if(chains.begin(), chains.end(),
+                                   [most](const search_chain &chain) { return chain.captured.size() < most; }),
+                         chains.end());
+        }
+        have_beats = true;
+    }
+
+    // Рекурсивная часть perft, доска после хода уровня ply хранится в ply_boards[ply]
+    uint64_t perft_rec(const vector<vector<POS_T>> &mtx, const bool color, const int depth, const int ply)
+    {
+        Arena::Rewind rewind;
+        search_chains chains;
+        generate_chains(color, mtx, chains);
+        if (depth == 1)
+            return chains.size();
+        uint64_t res = 0;
+        auto &next_mtx = ply_boards[ply];
+        for (const auto &chain : chains)
+        {
+            next_mtx = mtx;
+            apply_chain(next_mtx, chain);
+            res += perft_rec(next_mtx, !color, depth - 1, ply + 1);
+        }
+        return res;
+    }
+
+public:
+    // Выполняет полный ход на месте
+    void apply_chain(vector<vector<POS_T>> &mtx, const search_chain &chain) const
+    {
+        for (size_t i = 0; i < chain.path.size(); ++i)
+            apply_turn(mtx, chain.path[i], Rules::PROMOTE_IN_CAPTURE || i + 1 == chain.path.size());
+    }
+
+    // Находит все полные ходы для указанного цвета
+    // Серия взятий собирается целиком в один ход; цепочки одной шашки, которые
+    // заканчиваются в одной клетке с тем же набором побитых шашек, приводят к одинаковой
+    // позиции и объединяются в один ход
+    // Параметры:
+    // color - цвет игрока (true - черные, false - белые)
+    // mtx - текущее состояние доски
+    // Возвращает список полных ходов
+    vector<move_chain> find_chains(const bool color, const vector<vector<POS_T>> &mtx)
+    {
+        search_chains found;
+        generate_chains(color, mtx, found);
+        vector<move_chain> chains;
+        chains.reserve(found.size());
+        for (const auto &chain : found)
+            chains.push_back(move_chain{{chain.path.begin(), chain.path.end()},
+                                        {chain.captured.begin(), chain.captured.end()}});
+        return chains;
+    }
+
+    // Те же полные ходы в арене текущего потока: внутри Arena::Scope без обращений к куче
+    // (для переборов вне поиска, например решателя, см. Solver.h)
+    void find_chains(const bool color, const vector<vector<POS_T>> &mtx, search_chains &chains)
+    {
+        generate_chains(color, mtx, chains);
+    }
+
+    // Число позиций на глубине depth от позиции mtx (проверка генератора ходов, см. Perft.h)
+    // Ходы строятся так же, как в поиске: в арене и на досках уровней, без обращений к куче
+    uint64_t perft(const vector<vector<POS_T>> &mtx, const bool color, const int depth)
+    {
+        Arena::Scope scope(*arena);
+        arena->reset();
+        if (ply_boards.size() < size_t(depth))
+            ply_boards.resize(depth, empty_board());
+        return depth > 0 ? perft_rec(mtx, color, depth, 0) : 1;
+    }
+
+    // Выполняет ход на виртуальной доске и возвращает новое состояние
+    // Параметры:
+    // mtx - текущее состояние доски
+    // turn - ход, который нужно выполнить
+    // Возвращает новое состояние доски после выполнения хода
+    vector<vector<POS_T>> make_turn(vector<vector<POS_T>> mtx, move_pos turn) const
+    {
+        apply_turn(mtx, turn);
+        return mtx;
+    }
+
+    // Выполняет полный ход (всю серию взятий) на виртуальной доске и возвращает новое состояние
+    template <class Chain> vector<vector<POS_T>> make_turn(vector<vector<POS_T>> mtx, const Chain &chain) const
+    {
+        for (size_t i = 0; i < chain.path.size(); ++i)
+            apply_turn(mtx, chain.path[i], Rules::PROMOTE_IN_CAPTURE || i + 1 == chain.path.size());
+        return mtx;
+    }
+
+    // Проверяет, что позиция next получена из prev обратимым ходом:
+    // ходила дамка и ничего не было побито (простые шашки остались на месте)
+    static bool is_reversible(const vector<vector<POS_T>> &prev, const vector<vector<POS_T>> &next)
+    {
+        int prev_count = 0, next_count = 0;
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
+        {
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
             {
-                score = find_best_turns_rec(make_turn(mtx, turn), color, depth, alpha, beta, turn.x2, turn.y2);
+                if ((prev[i][j] == 1 || prev[i][j] == 2) && prev[i][j] != next[i][j])
+                    return false;
+                prev_count += (prev[i][j] != 0);
+                next_count += (next[i][j] != 0);
             }
-            min_score = min(min_score, score);
-            max_score = max(max_score, score);
-            // alpha-beta pruning
-            if (depth % 2)
-                alpha = max(alpha, max_score);
-            else
-                beta = min(beta, min_score);
-            if (optimization != "O0" && alpha >= beta)
-                return (depth % 2 ? max_score + 1 : min_score - 1);
         }
-        return (depth % 2 ? max_score : min_score);
+        return prev_count == next_count;
+    }
+
+    // Проверяет правила ничьей для последней позиции партии
+    // - позиция повторилась repetitions раз с той же очередью хода (0 - правило отключено)
+    // - king_moves ходов подряд каждой из сторон сделаны только дамками без взятий (0 - правило отключено)
+    // Параметр history - позиции после полных ходов партии (очередь хода в них чередуется)
+    // Возвращает true, если партия закончилась ничьей
+    static bool is_draw_by_rules(const vector<vector<vector<POS_T>>> &history, const int repetitions,
+                                 const int king_moves)
+    {
+        const size_t last = history.size() - 1;
+
+        if (repetitions > 0)
+        {
+            const uint64_t last_hash = Zobrist::hash(history[last], last % 2);
+            int count = 0;
+            // Повториться могут только позиции после последнего необратимого хода
+            for (size_t i = last + 1; i-- > 0;)
+            {
+                if ((last - i) % 2 == 0 && Zobrist::hash(history[i], i % 2) == last_hash)
+                    ++count;
+                if (i > 0 && !is_reversible(history[i - 1], history[i]))
+                    break;
+            }
+            if (count >= repetitions)
+                return true;
+        }
+
+        if (king_moves > 0)
+        {
+            int count = 0;  // Число ходов подряд только дамками без взятий
+            for (size_t i = last; i > 0 && is_reversible(history[i - 1], history[i]); --i)
+                ++count;
+            if (count >= 2 * king_moves)
+                return true;
+        }
+        return false;
     }
 
 public:
+    // Оценка позиции mtx без поиска с точки зрения игрока color в текущем режиме оценки
+    // (для доигровок MCTS, см. Mcts.h): -INF при проигрыше, INF при выигрыше,
+    // иначе в пределах (-SCORE_SCALE, SCORE_SCALE)
+    int static_score(const vector<vector<POS_T>> &mtx, const bool color) const
+    {
+        if (nnue)
+        {
+            Nnue::Accumulator acc;
+            nnue->refresh(mtx, acc);
+            return nnue_score(acc, color, 0);
+        }
+        return ratio_to_score(calc_score(mtx, color), 0);
+    }
+
+    // Загрузка весов материальной оценки из файла JSON вида {"Man": 20, "Advance": 1, "King": 100}
+    // Бросает runtime_error, если файл не открывается или веса неверны
+    static eval_weights load_weights(const string &path)
+    {
+        ifstream fin(path);
+        if (!fin)
+            throw runtime_error("can't open evaluation weights '" + path + "'");
+        const json j = json::parse(fin, nullptr, true, true);
+        eval_weights res;
+        res.man = j.at("Man");
+        res.advance = j.at("Advance");
+        res.king = j.at("King");
+        if (res.man <= 0 || res.advance < 0 || res.king <= 0)
+            throw runtime_error("bad evaluation weights in '" + path + "'");
+        return res;
+    }
+
     // Находит все возможные ходы для указанного цвета на текущей доске
     // Параметр color: true - черные, false - белые
     void find_turns(const bool color)
@@ -255,31 +1356,46 @@ private:
     // color - цвет игрока (true - черные, false - белые)
     // mtx - текущее состояние доски
     // Результат сохраняется в поля turns и have_beats
+    // Один проход по черным клеткам строит маску занятых клеток (для ходов дамок)
+    // и список шашек игрока, после чего ходы ищутся для каждой шашки
     void find_turns(const bool color, const vector<vector<POS_T>> &mtx)
     {
-        vector<move_pos> res_turns;
+        arena_vector<move_pos> res_turns;
         bool have_beats_before = false;
-        for (POS_T i = 0; i < 8; ++i)
+        POS_T own[Rules::SQUARES][2];
+        int own_count = 0;
+        occupied = 0;
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = (i + 1) % 2; j < Rules::SIZE; j += 2)
             {
-                if (mtx[i][j] && mtx[i][j] % 2 != color)
+                if (!mtx[i][j])
+                    continue;
+                occupied |= Bits(1) << Rules::square(i, j);
+                if (mtx[i][j] % 2 != color)
                 {
-                    find_turns(i, j, mtx);
-                    if (have_beats && !have_beats_before)
-                    {
-                        have_beats_before = true;
-                        res_turns.clear();
-                    }
-                    if ((have_beats_before && have_beats) || !have_beats_before)
-                    {
-                        res_turns.insert(res_turns.end(), turns.begin(), turns.end());
-                    }
+                    own[own_count][0] = i;
+                    own[own_count][1] = j;
+                    ++own_count;
                 }
             }
         }
-        turns = res_turns;
-        shuffle(turns.begin(), turns.end(), rand_eng);
+        for (int k = 0; k < own_count; ++k)
+        {
+            find_turns(own[k][0], own[k][1], mtx, occupied);
+            if (have_beats && !have_beats_before)
+            {
+                have_beats_before = true;
+                res_turns.clear();
+            }
+            if ((have_beats_before && have_beats) || !have_beats_before)
+            {
+                res_turns.insert(res_turns.end(), turns.begin(), turns.end());
+            }
+        }
+        turns.assign(res_turns.begin(), res_turns.end());
+        if (!no_random)
+            shuffle(turns.begin(), turns.end(), rand_eng);
         have_beats = have_beats_before;
     }
 
@@ -289,6 +1405,51 @@ private:
     // mtx - текущее состояние доски
     // Результат сохраняется в поля turns и have_beats
     void find_turns(const POS_T x, const POS_T y, const vector<vector<POS_T>> &mtx)
+    {
+        find_turns(x, y, mtx, mtx[x][y] > 2 ? occupancy(mtx) : 0);
+    }
+
+    // Маска занятых черных клеток доски
+    static Bits occupancy(const vector<vector<POS_T>> &mtx)
+    {
+        Bits res = 0;
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
+        {
+            for (POS_T j = (i + 1) % 2; j < Rules::SIZE; j += 2)
+            {
+                if (mtx[i][j])
+                    res |= Bits(1) << Rules::square(i, j);
+            }
+        }
+        return res;
+    }
+
+    // Маска занятых клеток после шага взятия turn
+    static Bits occupancy_after(const Bits occ, const move_pos &turn)
+    {
+        return (occ & ~(Bits(1) << Rules::square(turn.x, turn.y)) & ~(Bits(1) << Rules::square(turn.xb, turn.yb))) |
+               (Bits(1) << Rules::square(turn.x2, turn.y2));
+    }
+
+    // Добавляет ходы дамки из (x, y) на клетки маски land луча dir в порядке удаления от дамки
+    // (xb, yb) - побитая шашка или -1, если это не взятие
+    void add_king_turns(const POS_T x, const POS_T y, Bits land, const int dir, const POS_T xb, const POS_T yb)
+    {
+        while (land)
+        {
+            const int sq = KingRays::nearest(land, dir);
+            land &= ~(Bits(1) << sq);
+            turns.emplace_back(x, y, KingRays::row(sq), KingRays::col(sq), xb, yb);
+        }
+    }
+
+    // Находит все возможные ходы для шашки в указанной позиции
+    // Параметры:
+    // x, y - координаты шашки
+    // mtx - текущее состояние доски
+    // occ - маска занятых клеток mtx (нужна только для дамки)
+    // Результат сохраняется в поля turns и have_beats
+    void find_turns(const POS_T x, const POS_T y, const vector<vector<POS_T>> &mtx, const Bits occ)
     {
         turns.clear();
         have_beats = false;
@@ -301,14 +1462,17 @@ private:
         case 2:  // Черная шашка
             // Проверяем взятия для обычных шашек
             // Обычная шашка может бить на 2 клетки по диагонали в любом направлении
+            // (только вперед, если правила варианта не разрешают бить назад)
             // Шаг 4 используется, чтобы проверить клетки через одну:
             // - (i = x±2, j = y±2) - клетка, куда можно сделать ход
             // - ((x+i)/2, (y+j)/2) - клетка с шашкой противника, которую бьем
             for (POS_T i = x - 2; i <= x + 2; i += 4)
             {
+                if (!Rules::MEN_CAPTURE_BACKWARD && (i < x) != (type % 2 == 1))
+                    continue;
                 for (POS_T j = y - 2; j <= y + 2; j += 4)
                 {
-                    if (i < 0 || i > 7 || j < 0 || j > 7)  // Проверка выхода за границы доски
+                    if (!Rules::inside(i, j))  // Проверка выхода за границы доски
                         continue;
                     POS_T xb = (x + i) / 2, yb = (y + j) / 2;  // Координаты бьемой шашки
                     // Проверяем, что:
@@ -327,33 +1491,26 @@ private:
             // Проверяем взятия для дамок
             // Дамка может ходить на любое количество клеток по диагонали
             // и бить через любое количество пустых клеток
-            for (POS_T i = -1; i <= 1; i += 2)  // Направление движения по вертикали
+            // (недальнобойная дамка бьет только соседнюю шашку и встает сразу за ней)
+            // На каждом луче бить можно только ближайшую шашку, если она чужая, а встать -
+            // на свободные клетки за ней до следующей шашки (см. Rays.h)
             {
-                for (POS_T j = -1; j <= 1; j += 2)  // Направление движения по горизонтали
+                const int sq = Rules::square(x, y);
+                for (int dir = 0; dir < 4; ++dir)
                 {
-                    POS_T xb = -1, yb = -1;  // Координаты шашки, которую можем побить
-                    // Проверяем все клетки по диагонали в выбранном направлении
-                    for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
-                    {
-                        if (mtx[i2][j2])  // Если встретили шашку
-                        {
-                            // Если это шашка того же цвета или мы уже нашли шашку для взятия,
-                            // то дальше идти нельзя
-                            if (mtx[i2][j2] % 2 == type % 2 || (mtx[i2][j2] % 2 != type % 2 && xb != -1))
-                            {
-                                break;
-                            }
-                            // Запоминаем координаты шашки, которую можем побить
-                            xb = i2;
-                            yb = j2;
-                        }
-                        // Если нашли шашку для взятия и текущая клетка пуста,
-                        // то можем сделать ход на эту клетку
-                        if (xb != -1 && xb != i2)
-                        {
-                            turns.emplace_back(x, y, i2, j2, xb, yb);
-                        }
-                    }
+                    const Bits blockers = KingRays::ray(sq, dir) & occ;
+                    if (!blockers)
+                        continue;
+                    const int b = KingRays::nearest(blockers, dir);
+                    const POS_T xb = KingRays::row(b), yb = KingRays::col(b);  // Шашка, которую можем побить
+                    if (mtx[xb][yb] % 2 == type % 2)
+                        continue;
+                    if (!Rules::FLYING_KINGS && b != KingRays::nearest(KingRays::ray(sq, dir), dir))
+                        continue;
+                    Bits land = KingRays::free_part(b, dir, occ);
+                    if (!Rules::FLYING_KINGS && land)
+                        land = Bits(1) << KingRays::nearest(land, dir);
+                    add_king_turns(x, y, land, dir, xb, yb);
                 }
             }
             break;
@@ -381,7 +1538,7 @@ private:
                 for (POS_T j = y - 1; j <= y + 1; j += 2)  // Проверяем обе диагонали
                 {
                     // Проверяем выход за границы доски и наличие других шашек
-                    if (i < 0 || i > 7 || j < 0 || j > 7 || mtx[i][j])
+                    if (!Rules::inside(i, j) || mtx[i][j])
                         continue;
                     turns.emplace_back(x, y, i, j);
                 }
@@ -392,17 +1549,15 @@ private:
         default:  // Дамки (тип 3 и 4)
             // Проверяем ходы для дамок
             // Дамка может ходить на любое количество клеток по диагонали в любом направлении
-            for (POS_T i = -1; i <= 1; i += 2)  // Направление движения по вертикали
+            // до первой шашки на луче (недальнобойная - на одну клетку)
             {
-                for (POS_T j = -1; j <= 1; j += 2)  // Направление движения по горизонтали
+                const int sq = Rules::square(x, y);
+                for (int dir = 0; dir < 4; ++dir)
                 {
-                    // Проверяем все клетки по диагонали в выбранном направлении
-                    for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
-                    {
-                        if (mtx[i2][j2])  // Если встретили шашку, дальше идти нельзя
-                            break;
-                        turns.emplace_back(x, y, i2, j2);
-                    }
+                    Bits land = KingRays::free_part(sq, dir, occ);
+                    if (!Rules::FLYING_KINGS && land)
+                        land = Bits(1) << KingRays::nearest(land, dir);
+                    add_king_turns(x, y, land, dir, -1, -1);
                 }
             }
             break;
@@ -419,23 +1574,133 @@ private:
     // Максимальная глубина поиска для бота (уровень сложности)
     int Max_depth;
 
+    // Число позиций, рассмотренных последним поиском
+    uint64_t nodes = 0;
+
+    // Оценка лучшего хода последнего поиска с точки зрения ходившего игрока
+    int last_score = 0;
+
+    // Флаг остановки поиска, который может выставить другой поток (nullptr - не используется)
+    const atomic<bool> *stop_flag = nullptr;
+
+    // Число лучших ходов, для которых search уточняет оценки на каждой итерации (multi-PV, см. search_info::lines)
+    // 1 - только лучший ход. Каждый дополнительный ход стоит еще одного поиска корня на глубину итерации
+    int multi_pv = 1;
+
+    // Вызывается во время поиска через каждые 1024 позиции вместе с проверкой ограничений
+    // (nullptr - не вызывается): например, планировщик приостанавливает здесь поиск в конце кванта
+    function<void()> on_yield;
+
+    // Таблица транспозиций (nullptr - не используется), может быть общей для нескольких экземпляров
+    TransTable *tt = nullptr;
+
+    // Пакетная оценка листьев на предпоследнем уровне поиска (false - каждый лист оценивается отдельно)
+    bool batch_leaves = true;
+
+    // Амплитуда случайной добавки к оценке листьев (0 - без добавки), ослабляет бота на низких
+    // уровнях сложности (см. Difficulty.h)
+    int eval_noise = 0;
+
+    // Число поисков, начавшихся с предсказанной позиции (ход из прошлого поиска перебирался первым)
+    uint64_t predicted_hits = 0;
+
   private:
     // Генератор случайных чисел для выбора хода
     default_random_engine rand_eng;
+
+    // Отключение случайности: ходы перебираются в детерминированном порядке
+    bool no_random;
     
     // Режим подсчета очков: "Number" - только количество шашек,
     // "NumberAndPotential" - количество шашек и их потенциал
     string scoring_mode;
+
+    // Учитывается ли продвижение шашек (режим "NumberAndPotential")
+    bool potential_scoring;
+
+    // Веса материальной оценки режима "NumberAndPotential"
+    eval_weights weights;
     
     // Уровень оптимизации: "O0" - без оптимизации,
     // другие значения - с альфа-бета отсечением
     string optimization;
-    
-    // Вектор ходов для каждого состояния при поиске лучшего хода
-    vector<move_pos> next_move;
-    
-    // Вектор следующих состояний при поиске лучшего хода
-    vector<int> next_best_state;
+
+    // Числовой уровень оптимизации (0 для "O0", 1 для "O1" и т.д.)
+    int opt_level;
+
+    // Поиск в корне методом MTD(f) (суффикс "-MTDF" уровня оптимизации)
+    bool mtdf = false;
+
+    // Добавка к ключу таблицы транспозиций, зависящая от режима оценки
+    uint64_t tt_salt = 14695981039346656037ull;
+
+    // Зерно случайной добавки к оценке листьев текущего поиска (0 - без случайности)
+    uint64_t noise_seed = 0;
+
+    // Ходы-убийцы (по два на каждый уровень поиска), вызвавшие отсечение
+    vector<array<int, 2>> killers;
+
+    // Маска занятых клеток позиции последнего вызова find_turns(color, mtx)
+    Bits occupied = 0;
+
+    // Номер и хеш корневой позиции прошлого поиска в истории партии (для сдвига ходов-убийц)
+    size_t last_root = 0;
+    uint64_t last_root_hash = 0;
+
+    // Для каждого цвета: хеш позиции, ожидаемой к его следующему поиску (после лучшего хода
+    // и ответа соперника), и код лучшего хода в ней (-1 - ожидания нет). Цвета хранятся отдельно,
+    // потому что один экземпляр может искать ходы за обе стороны
+    array<uint64_t, 2> expected_hash = {0, 0};
+    array<int, 2> expected_move = {-1, -1};
+
+    // Поиск прерван по ограничениям, результат текущей итерации неполный
+    bool aborted = false;
+
+    // В прерванной итерации успел полностью рассмотреться хотя бы первый ход корня
+    bool root_complete = false;
+
+    // Ограничение числа позиций (0 - без ограничения)
+    uint64_t max_nodes = 0;
+
+    // Момент, когда поиск должен быть остановлен
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+
+    // Хеши позиций партии и текущего пути поиска
+    vector<uint64_t> position_hashes;
+
+    // Начало окна обратимых ходов в position_hashes: более ранние позиции не могут повториться
+    size_t reversible_from = 0;
+
+    // Таблица истории: бонусы тихих ходов, вызвавших отсечение, по начальной и конечной клетке
+    vector<int> history;
+
+    // Арена для временных данных поиска (сбрасывается в начале каждого поиска)
+    unique_ptr<Arena> arena = make_unique<Arena>();
+
+    // Состояние пошагового поиска между begin_search и end_search
+    struct
+    {
+        vector<vector<POS_T>> mtx;
+        bool color = false;
+        search_chains chains;  // Корневые ходы в арене, лучший ход предыдущей итерации первый
+        int depth = 0;         // Глубина следующей итерации
+        int max_depth = 0;
+        bool done = true;
+        chrono::steady_clock::time_point start;
+        search_info info;  // Последняя завершенная итерация
+    } step;
+
+    // Доски после хода на каждом уровне поиска
+    vector<vector<vector<POS_T>>> ply_boards;
+
+    // Нейросеть режима "NNUE" (nullptr в других режимах), веса общие для копий логики
+    shared_ptr<const Nnue> nnue;
+
+    // Накопители нейросети для позиции на каждом уровне поиска (индекс - ply)
+    vector<Nnue::Accumulator> accumulators;
+
+    // Доски после каждого шага серии взятий при построении ходов
+    vector<vector<vector<POS_T>>> chain_boards;
     
     // Указатель на игровую доску
     Board *board;
@@ -443,3 +1708,5 @@ private:
     // Указатель на конфигурацию игры
     Config *config;
 };
+
+typedef BasicLogic<RussianRules> Logic;
@@ -0,0 +1,315 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Logic.h"
+
+// Бот на основе поиска по дереву методом Монте-Карло (UCT) - альтернатива минимаксу
+// для более слабых и "человечных" уровней (настройки WhiteBotType и BlackBotType: "MCTS")
+//
+// Каждая итерация спускается от корня по дереву, выбирая ход по формуле UCB, раскрывает лист,
+// доигрывает партию несколько полуходов и возвращает результат доигровки по пути к корню.
+// Доигровка легкая: из двух случайных ходов выбирается лучший по оценке позиции (Logic::static_score),
+// а после PLAYOUT_PLIES полуходов итог определяется той же оценкой
+// Ход - полный ход (вся серия взятий), поэтому результат - последовательность шагов хода
+//
+// Параллельность по дереву: все потоки работают с одним деревом. Счетчики узлов атомарны,
+// узел раскрывает только поток, первым захвативший его (остальные доигрывают из него же),
+// а на время итерации узлы пути получают "виртуальный проигрыш", чтобы другие потоки
+// выбирали другие ветви. Узлы берутся из заранее выделенного пула (один атомарный счетчик),
+// при исчерпании пула дерево перестает расти, а поиск продолжается доигровками
+// Параметр Rules - вариант правил (см. Rules.h)
+template <class Rules> class BasicMcts
+{
+  public:
+    // Параметры:
+    // config - настройки бота (режим оценки позиции для доигровок, NoRandom)
+    // threads - число потоков поиска (0 - по числу ядер процессора)
+    // pool_nodes - размер пула узлов дерева
+    explicit BasicMcts(Config *config, size_t threads = 0, const size_t pool_nodes = 1 << 20)
+        : pool(new Node[pool_nodes]), capacity(uint32_t(pool_nodes)),
+          // Потомки узла определяются порядком ходов генератора, поэтому генератор не перемешивает ходы
+          // (случайность MCTS - в выборе ходов доигровок)
+          generator_config(json{{"Bot",
+                                 {{"NoRandom", true},
+                                  {"BotScoringType", (*config)("Bot", "BotScoringType")},
+                                  {"NnueWeights", config->value("Bot", "NnueWeights", "nnue.bin")},
+                                  {"EvalWeights", config->value("Bot", "EvalWeights", "")},
+                                  {"Optimization", "O1"}}}})
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < threads; ++i)
+            workers.push_back(std::make_unique<BasicLogic<Rules>>(nullptr, &generator_config));
+        no_random = (*config)("Bot", "NoRandom");
+    }
+
+    // Поиск хода в позиции mtx с ходом игрока color (true - черные, false - белые)
+    // Поиск останавливается по времени limits.time_ms, по числу доигровок limits.nodes
+    // или по флагу stop_flag (ограничение глубины не используется); если не задано ни время, ни число
+    // доигровок, поиск ограничивается временем DEFAULT_TIME_MS, иначе он бы не закончился
+    // Возвращает самый посещаемый ход корня; depth - наибольшая глубина дерева,
+    // score - доля выигрышей лучшего хода, переведенная в шкалу оценки Logic, nodes - число доигровок
+    search_info search(const std::vector<std::vector<POS_T>> &mtx, const bool color, const search_limits &limits)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const int64_t time_ms = (limits.time_ms || limits.nodes) ? limits.time_ms : DEFAULT_TIME_MS;
+        deadline = time_ms ? start + std::chrono::milliseconds(time_ms) : std::chrono::steady_clock::time_point::max();
+        max_playouts = limits.nodes;
+        playouts = 0;
+        max_depth = 0;
+        used = 0;
+        allocate(1);
+
+        const auto chains = workers[0]->find_chains(color, mtx);
+        search_info info;
+        if (chains.empty())
+            return info;
+        // Единственный ход не требует поиска
+        if (chains.size() > 1)
+        {
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < workers.size(); ++i)
+                threads.emplace_back([this, &mtx, color, i] { work(*workers[i], mtx, color, i); });
+            work(*workers[0], mtx, color, 0);
+            for (auto &th : threads)
+                th.join();
+        }
+
+        // Самый посещаемый ход корня
+        const Node &root = pool[0];
+        size_t best = 0;
+        if (root.state.load(std::memory_order_acquire) == EXPANDED)
+        {
+            const uint32_t first = root.first_child.load(std::memory_order_relaxed);
+            for (uint32_t i = 1; i < root.child_count.load(std::memory_order_relaxed); ++i)
+            {
+                if (pool[first + i].visits.load(std::memory_order_relaxed) >
+                    pool[first + best].visits.load(std::memory_order_relaxed))
+                    best = i;
+            }
+            const Node &child = pool[first + best];
+            const uint32_t n = child.visits.load(std::memory_order_relaxed);
+            if (n)
+            {
+                const double q = double(child.value.load(std::memory_order_relaxed)) / VALUE_ONE / n;
+                info.score = int(lround((2 * q - 1) * (SCORE_SCALE - 1)));
+            }
+        }
+        info.best.assign(chains[best].path.begin(), chains[best].path.end());
+        info.depth = max_depth.load();
+        info.nodes = playouts.load();
+        info.time_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        return info;
+    }
+
+    // Флаг остановки поиска, который может выставить другой поток (nullptr - не используется)
+    const std::atomic<bool> *stop_flag = nullptr;
+
+  private:
+    // Состояния узла
+    static const uint8_t UNEXPANDED = 0, EXPANDING = 1, EXPANDED = 2;
+
+    // Узел дерева: ход из родителя в узел задается номером узла среди потомков родителя
+    // (потомки лежат в пуле подряд в порядке Logic::find_chains)
+    struct Node
+    {
+        std::atomic<uint32_t> visits{0};        // Число завершенных доигровок через узел
+        std::atomic<uint32_t> virtual_loss{0};  // Число незавершенных итераций через узел
+        std::atomic<int64_t> value{0};          // Сумма результатов для игрока, сделавшего ход в узел (VALUE_ONE - выигрыш)
+        std::atomic<uint32_t> first_child{0};   // Номер первого потомка в пуле
+        std::atomic<uint32_t> child_count{0};   // Число потомков (0 у раскрытого узла - нет ходов)
+        std::atomic<uint8_t> state{UNEXPANDED};
+    };
+
+    static const int64_t VALUE_ONE = 1 << 16;  // Результат "выигрыш" в единицах value
+    static constexpr double EXPLORATION = 1.0;  // Коэффициент исследования в формуле UCB
+    static const int PLAYOUT_PLIES = 12;        // Длина доигровки в полуходах
+    static const int MAX_TREE_DEPTH = 256;
+    static const int64_t DEFAULT_TIME_MS = 700;  // Время поиска без заданных ограничений (как у уровня 5)
+
+    // Выделение count подряд идущих узлов пула
+    // Возвращает номер первого узла или capacity, если пул исчерпан
+    uint32_t allocate(const uint32_t count)
+    {
+        if (used.load(std::memory_order_relaxed) >= capacity)
+            return capacity;
+        const uint32_t first = used.fetch_add(count, std::memory_order_relaxed);
+        if (first + count > capacity || first + count < first)
+            return capacity;
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            pool[i].visits.store(0, std::memory_order_relaxed);
+            pool[i].virtual_loss.store(0, std::memory_order_relaxed);
+            pool[i].value.store(0, std::memory_order_relaxed);
+            pool[i].child_count.store(0, std::memory_order_relaxed);
+            pool[i].state.store(UNEXPANDED, std::memory_order_relaxed);
+        }
+        return first;
+    }
+
+    // Остановить ли поиск
+    bool out_of_limits() const
+    {
+        if (stop_flag && stop_flag->load(std::memory_order_relaxed))
+            return true;
+        if (max_playouts && playouts.load(std::memory_order_relaxed) >= max_playouts)
+            return true;
+        return std::chrono::steady_clock::now() >= deadline;
+    }
+
+    // Цикл итераций одного потока
+    void work(BasicLogic<Rules> &logic, const std::vector<std::vector<POS_T>> &root_mtx, const bool root_color,
+              const size_t index)
+    {
+        std::mt19937_64 rng(no_random ? index : std::random_device{}() ^ (uint64_t(index) << 32));
+        std::vector<uint32_t> path;
+        std::vector<std::vector<POS_T>> mtx;
+        while (!out_of_limits())
+        {
+            mtx = root_mtx;
+            bool color = root_color;
+            path.assign(1, 0);
+            pool[0].virtual_loss.fetch_add(1, std::memory_order_relaxed);
+            double result = -1;  // Результат для игрока, ходящего в последнем узле пути (-1 - нужна доигровка)
+            while (true)
+            {
+                Node &node = pool[path.back()];
+                uint8_t state = node.state.load(std::memory_order_acquire);
+                if (state == UNEXPANDED && (path.size() == 1 || node.visits.load(std::memory_order_relaxed) > 0) &&
+                    node.state.compare_exchange_strong(state, EXPANDING, std::memory_order_acq_rel))
+                {
+                    state = expand(logic, node, mtx, color) ? EXPANDED : UNEXPANDED;
+                    node.state.store(state, std::memory_order_release);
+                }
+                if (state != EXPANDED)
+                    break;
+                const uint32_t count = node.child_count.load(std::memory_order_relaxed);
+                if (count == 0)
+                {
+                    result = 0;  // Нет ходов - проигрыш ходящего
+                    break;
+                }
+                if (path.size() > MAX_TREE_DEPTH)
+                    break;
+                const uint32_t k = select(node, count);
+                const auto chains = logic.find_chains(color, mtx);
+                mtx = logic.make_turn(mtx, chains[k]);
+                color = !color;
+                path.push_back(node.first_child.load(std::memory_order_relaxed) + k);
+                pool[path.back()].virtual_loss.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (result < 0)
+                result = playout(logic, mtx, color, rng);
+            backpropagate(path, result);
+            playouts.fetch_add(1, std::memory_order_relaxed);
+            uint32_t depth = max_depth.load(std::memory_order_relaxed);
+            while (path.size() - 1 > depth &&
+                   !max_depth.compare_exchange_weak(depth, uint32_t(path.size() - 1), std::memory_order_relaxed))
+            {
+            }
+        }
+    }
+
+    // Раскрытие узла: выделение потомков по числу полных ходов
+    // Возвращает false, если пул исчерпан
+    bool expand(BasicLogic<Rules> &logic, Node &node, const std::vector<std::vector<POS_T>> &mtx, const bool color)
+    {
+        const uint32_t count = uint32_t(logic.find_chains(color, mtx).size());
+        if (count)
+        {
+            const uint32_t first = allocate(count);
+            if (first == capacity)
+                return false;
+            node.first_child.store(first, std::memory_order_relaxed);
+        }
+        node.child_count.store(count, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Выбор потомка по формуле UCB: средний результат плюс добавка за редкие посещения
+    // Незавершенные итерации считаются проигрышами (виртуальный проигрыш), не посещенный потомок выбирается сразу
+    uint32_t select(const Node &node, const uint32_t count) const
+    {
+        const uint32_t first = node.first_child.load(std::memory_order_relaxed);
+        const double log_n = std::log(double(node.visits.load(std::memory_order_relaxed) +
+                                             node.virtual_loss.load(std::memory_order_relaxed)) + 1);
+        uint32_t best = 0;
+        double best_ucb = -1;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const Node &child = pool[first + i];
+            const uint32_t n = child.visits.load(std::memory_order_relaxed) +
+                               child.virtual_loss.load(std::memory_order_relaxed);
+            if (n == 0)
+                return i;
+            const double q = double(child.value.load(std::memory_order_relaxed)) / VALUE_ONE / n;
+            const double ucb = q + EXPLORATION * std::sqrt(log_n / n);
+            if (ucb > best_ucb)
+            {
+                best_ucb = ucb;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    // Легкая доигровка из позиции mtx с ходом color
+    // Возвращает результат (0 - проигрыш, 1 - выигрыш) для игрока color
+    double playout(BasicLogic<Rules> &logic, std::vector<std::vector<POS_T>> mtx, const bool color,
+                   std::mt19937_64 &rng) const
+    {
+        bool side = color;
+        for (int ply = 0; ply < PLAYOUT_PLIES; ++ply)
+        {
+            const auto chains = logic.find_chains(side, mtx);
+            if (chains.empty())
+                return side == color ? 0 : 1;
+            // Из двух случайных ходов выбирается лучший для ходящего по оценке позиции
+            auto next = logic.make_turn(mtx, chains[rng() % chains.size()]);
+            if (chains.size() > 1)
+            {
+                auto other = logic.make_turn(mtx, chains[rng() % chains.size()]);
+                if (logic.static_score(other, side) > logic.static_score(next, side))
+                    next = std::move(other);
+            }
+            mtx = std::move(next);
+            side = !side;
+        }
+        const int score = logic.static_score(mtx, color);
+        return std::max(0.0, std::min(1.0, 0.5 + 0.5 * score / SCORE_SCALE));
+    }
+
+    // Учет результата итерации в узлах пути: result - результат для игрока, ходящего в последнем узле
+    // Значение узла хранится для игрока, сделавшего ход в узел, поэтому результат чередуется по уровням
+    void backpropagate(const std::vector<uint32_t> &path, double result)
+    {
+        for (size_t i = path.size(); i-- > 0;)
+        {
+            Node &node = pool[path[i]];
+            result = 1 - result;
+            node.value.fetch_add(int64_t(llround(result * VALUE_ONE)), std::memory_order_relaxed);
+            node.visits.fetch_add(1, std::memory_order_relaxed);
+            node.virtual_loss.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::unique_ptr<Node[]> pool;                        // Пул узлов дерева, корень - узел 0
+    const uint32_t capacity;                             // Размер пула
+    std::atomic<uint32_t> used{0};                       // Число выделенных узлов
+    Config generator_config;                             // Настройки генераторов ходов
+    std::vector<std::unique_ptr<BasicLogic<Rules>>> workers;  // Генераторы ходов потоков
+    bool no_random = false;                              // Одинаковые последовательности случайных чисел
+    std::chrono::steady_clock::time_point deadline;
+    uint64_t max_playouts = 0;
+    std::atomic<uint64_t> playouts{0};                   // Число завершенных итераций
+    std::atomic<uint32_t> max_depth{0};                  // Наибольшая глубина пути в дереве
+};
+
+typedef BasicMcts<RussianRules> Mcts;
@@ -0,0 +1,257 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../Models/Move.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define NNUE_SSE2
+#endif
+
+// Нейросетевая оценка позиции (режим оценки "NNUE")
+// Сеть из двух слоев с целочисленными весами:
+// 1. Вход - 128 признаков с точки зрения каждого игрока: тип фигуры (своя шашка, своя дамка,
+//    шашка соперника, дамка соперника) x 32 черные клетки. Для черных доска поворачивается
+//    на 180 градусов, поэтому свои шашки всегда идут к строке 0. Первый слой (веса int16)
+//    хранится как накопитель: сумма столбцов весов активных признаков для каждого игрока.
+//    Ход меняет несколько признаков, поэтому накопитель позиции после хода получается из
+//    накопителя позиции до хода прибавлением и вычитанием нескольких столбцов
+// 2. Выход - накопители ходящего игрока и соперника, ограниченные диапазоном [0, ACT_MAX],
+//    умножаются на веса int8 и складываются (SSE2, если есть, иначе обычным кодом)
+class Nnue
+{
+  public:
+    static const int FEATURES = 128;  // Число входных признаков для одного игрока
+    static const int HIDDEN = 32;     // Размер накопителя для одного игрока
+    static const int ACT_MAX = 127;   // Верхняя граница активации (соответствует 1.0)
+    static const int WEIGHT_ONE = 64; // Выходной вес, соответствующий 1.0
+    static const int OUTPUT_SCALE = 1600; // Оценка при сумме 1.0 (одна шашка - примерно 400)
+
+    // Накопитель позиции: суммы первого слоя для белых (индекс 0) и черных (индекс 1)
+    // и число фигур каждого цвета (позиция без фигур - проигрыш)
+    struct Accumulator
+    {
+        alignas(16) int16_t values[2][HIDDEN];
+        int pieces[2];
+    };
+
+    // Загрузка весов из файла
+    // Формат (little-endian): "CKNN", uint32 HIDDEN, int16 feature_weights[FEATURES][HIDDEN],
+    // int16 feature_bias[HIDDEN], int8 output_weights[2 * HIDDEN], int32 output_bias
+    // Бросает runtime_error, если файл не открывается или имеет другой формат
+    static std::shared_ptr<const Nnue> load(const std::string &path)
+    {
+        std::ifstream fin(path, std::ios::binary);
+        if (!fin)
+            throw std::runtime_error("can't open NNUE weights '" + path + "'");
+        char magic[4];
+        uint32_t hidden = 0;
+        fin.read(magic, 4);
+        fin.read(reinterpret_cast<char *>(&hidden), sizeof(hidden));
+        if (!fin || std::memcmp(magic, "CKNN", 4) != 0 || hidden != HIDDEN)
+            throw std::runtime_error("bad NNUE weights header in '" + path + "'");
+        auto net = std::make_shared<Nnue>();
+        int8_t output[2 * HIDDEN];
+        fin.read(reinterpret_cast<char *>(net->feature_weights), sizeof(net->feature_weights));
+        fin.read(reinterpret_cast<char *>(net->feature_bias), sizeof(net->feature_bias));
+        fin.read(reinterpret_cast<char *>(output), sizeof(output));
+        fin.read(reinterpret_cast<char *>(&net->output_bias), sizeof(net->output_bias));
+        if (!fin)
+            throw std::runtime_error("truncated NNUE weights '" + path + "'");
+        for (int i = 0; i < 2 * HIDDEN; ++i)
+            net->output_weights[i] = output[i];
+        return net;
+    }
+
+    // Сохранение весов в файл (формат см. load)
+    void save(const std::string &path) const
+    {
+        std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+        const uint32_t hidden = HIDDEN;
+        int8_t output[2 * HIDDEN];
+        for (int i = 0; i < 2 * HIDDEN; ++i)
+            output[i] = int8_t(output_weights[i]);
+        fout.write("CKNN", 4);
+        fout.write(reinterpret_cast<const char *>(&hidden), sizeof(hidden));
+        fout.write(reinterpret_cast<const char *>(feature_weights), sizeof(feature_weights));
+        fout.write(reinterpret_cast<const char *>(feature_bias), sizeof(feature_bias));
+        fout.write(reinterpret_cast<const char *>(output), sizeof(output));
+        fout.write(reinterpret_cast<const char *>(&output_bias), sizeof(output_bias));
+        if (!fout)
+            throw std::runtime_error("can't write NNUE weights '" + path + "'");
+    }
+
+    // Веса, повторяющие оценку "NumberAndPotential" вблизи равного материала:
+    // нейроны 0-7 считают свои шашки по строкам (чем ближе к превращению, тем дороже),
+    // нейроны 8-15 - свои дамки, выход - разность этих сумм для ходящего игрока и соперника
+    // Используются как начальные веса для обучения (файл nnue.bin в корне проекта)
+    static std::shared_ptr<Nnue> material()
+    {
+        auto net = std::make_shared<Nnue>();
+        std::memset(net->feature_weights, 0, sizeof(net->feature_weights));
+        std::memset(net->feature_bias, 0, sizeof(net->feature_bias));
+        std::memset(net->output_weights, 0, sizeof(net->output_weights));
+        net->output_bias = 0;
+        const double unit = double(OUTPUT_SCALE) / (ACT_MAX * WEIGHT_ONE);
+        for (int sq = 0; sq < 32; ++sq)
+        {
+            const int row = sq / 4;
+            net->feature_weights[sq][row] = 32;  // Своя шашка (до 4 в строке)
+            for (int k = 8; k < 16; ++k)
+                net->feature_weights[32 + sq][k] = 16;  // Своя дамка (до 8 дамок)
+        }
+        for (int row = 0; row < 8; ++row)
+        {
+            const int w = int(std::lround((400 + 20 * (7 - row)) / (32 * unit)));
+            net->output_weights[row] = w;
+            net->output_weights[HIDDEN + row] = -w;
+        }
+        for (int k = 8; k < 16; ++k)
+        {
+            const int w = int(std::lround(2000 / (8 * 16 * unit)));
+            net->output_weights[k] = w;
+            net->output_weights[HIDDEN + k] = -w;
+        }
+        return net;
+    }
+
+    // Построение накопителя позиции заново
+    void refresh(const std::vector<std::vector<POS_T>> &mtx, Accumulator &acc) const
+    {
+        for (int p = 0; p < 2; ++p)
+        {
+            std::memcpy(acc.values[p], feature_bias, sizeof(feature_bias));
+            acc.pieces[p] = 0;
+        }
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = (i + 1) % 2; j < 8; j += 2)
+            {
+                if (mtx[i][j])
+                    add_piece(acc, mtx[i][j], i * 4 + j / 2);
+            }
+        }
+    }
+
+    // Накопитель позиции после полного хода chain
+    // Параметры:
+    // parent - накопитель позиции до хода
+    // mtx - доска до хода
+    // chain - полный ход
+    // final_type - тип фигуры в конце хода (с учетом превращения)
+    // child - накопитель позиции после хода
+    template <class Chain>
+    void update(const Accumulator &parent, const std::vector<std::vector<POS_T>> &mtx, const Chain &chain,
+                const POS_T final_type, Accumulator &child) const
+    {
+        child = parent;
+        remove_piece(child, mtx[chain.x()][chain.y()], chain.x() * 4 + chain.y() / 2);
+        for (const auto &cell : chain.captured)
+            remove_piece(child, mtx[cell.first][cell.second], cell.first * 4 + cell.second / 2);
+        add_piece(child, final_type, chain.x2() * 4 + chain.y2() / 2);
+    }
+
+    // Оценка позиции с точки зрения игрока color в единицах целочисленной оценки поиска
+    // (без учета выигрыша и проигрыша, см. Accumulator::pieces)
+    int evaluate(const Accumulator &acc, const bool color) const
+    {
+        const int16_t *us = acc.values[color ? 1 : 0];
+        const int16_t *them = acc.values[color ? 0 : 1];
+        const int64_t sum = int64_t(output_bias) + dot(us, output_weights) + dot(them, output_weights + HIDDEN);
+        return int(sum * OUTPUT_SCALE / (ACT_MAX * WEIGHT_ONE));
+    }
+
+  private:
+    // Индекс признака фигуры type в бите b с точки зрения игрока perspective
+    static int feature(const int perspective, const POS_T type, const int b)
+    {
+        const int piece_color = (type - 1) % 2;
+        const int kind = (piece_color == perspective ? 0 : 2) + (type > 2 ? 1 : 0);
+        return kind * 32 + (perspective ? 31 - b : b);
+    }
+
+    void add_piece(Accumulator &acc, const POS_T type, const int b) const
+    {
+        for (int p = 0; p < 2; ++p)
+            add_column(acc.values[p], feature_weights[feature(p, type, b)]);
+        ++acc.pieces[(type - 1) % 2];
+    }
+
+    void remove_piece(Accumulator &acc, const POS_T type, const int b) const
+    {
+        for (int p = 0; p < 2; ++p)
+            sub_column(acc.values[p], feature_weights[feature(p, type, b)]);
+        --acc.pieces[(type - 1) % 2];
+    }
+
+    static void add_column(int16_t *acc, const int16_t *column)
+    {
+#ifdef NNUE_SSE2
+        for (int i = 0; i < HIDDEN; i += 8)
+        {
+            auto *dst = reinterpret_cast<__m128i *>(acc + i);
+            const __m128i w = _mm_load_si128(reinterpret_cast<const __m128i *>(column + i));
+            _mm_store_si128(dst, _mm_add_epi16(_mm_load_si128(dst), w));
+        }
+#else
+        for (int i = 0; i < HIDDEN; ++i)
+            acc[i] += column[i];
+#endif
+    }
+
+    static void sub_column(int16_t *acc, const int16_t *column)
+    {
+#ifdef NNUE_SSE2
+        for (int i = 0; i < HIDDEN; i += 8)
+        {
+            auto *dst = reinterpret_cast<__m128i *>(acc + i);
+            const __m128i w = _mm_load_si128(reinterpret_cast<const __m128i *>(column + i));
+            _mm_store_si128(dst, _mm_sub_epi16(_mm_load_si128(dst), w));
+        }
+#else
+        for (int i = 0; i < HIDDEN; ++i)
+            acc[i] -= column[i];
+#endif
+    }
+
+    // Сумма произведений активаций clamp(acc, 0, ACT_MAX) на выходные веса
+    static int dot(const int16_t *acc, const int16_t *weights)
+    {
+#ifdef NNUE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i top = _mm_set1_epi16(ACT_MAX);
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < HIDDEN; i += 8)
+        {
+            const __m128i a = _mm_load_si128(reinterpret_cast<const __m128i *>(acc + i));
+            const __m128i act = _mm_min_epi16(_mm_max_epi16(a, zero), top);
+            const __m128i w = _mm_load_si128(reinterpret_cast<const __m128i *>(weights + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(act, w));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(sum);
+#else
+        int sum = 0;
+        for (int i = 0; i < HIDDEN; ++i)
+            sum += std::min(std::max(int(acc[i]), 0), ACT_MAX) * weights[i];
+        return sum;
+#endif
+    }
+
+    // Столбцы первого слоя по признакам
+    alignas(16) int16_t feature_weights[FEATURES][HIDDEN];
+    alignas(16) int16_t feature_bias[HIDDEN];
+    // Выходные веса (в файле int8, в памяти int16 для умножения SSE2): сначала для накопителя
+    // ходящего игрока, затем для накопителя соперника
+    alignas(16) int16_t output_weights[2 * HIDDEN];
+    int32_t output_bias = 0;
+};
@@ -0,0 +1,251 @@
+#pragma once
+#include <sstream>
+#include <stdexcept>
+
+#include "../Models/Position.h"
+#include "Logic.h"
+
+// Текстовая запись позиций и партий (FEN и PDN для русских шашек)
+//
+// Клетки записываются алгебраически: столбцы a-h слева направо, горизонтали 1-8 снизу вверх,
+// белые начинают партию снизу (клетка a1 - строка 7, столбец 0 матрицы доски)
+// FEN: "<W|B>:W<клетки белых>:B<клетки черных>", дамки отмечаются префиксом K,
+// например "W:Wa1,c3,Kd4:Bf6,h8"
+// Ходы: "c3-d4" - тихий ход, "c3:e5:c7" - серия взятий (вместо ':' допускается 'x')
+class Notation
+{
+  public:
+    // Запись клетки (x, y) матрицы доски, например "c3"
+    static string square(const POS_T x, const POS_T y)
+    {
+        return string{char('a' + y), char('1' + 7 - x)};
+    }
+
+    // Разбор клетки в координаты (x, y) матрицы доски
+    // Бросает runtime_error, если клетка записана неверно или является белой
+    static pair<POS_T, POS_T> parse_square(const string &text)
+    {
+        if (text.size() != 2 || text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8')
+            throw runtime_error("bad square '" + text + "'");
+        POS_T x = POS_T(7 - (text[1] - '1')), y = POS_T(text[0] - 'a');
+        if ((x + y) % 2 == 0)
+            throw runtime_error("square '" + text + "' is not playable");
+        return {x, y};
+    }
+
+    // Разбор позиции из FEN
+    static game_position parse_fen(const string &fen)
+    {
+        game_position pos{vector<vector<POS_T>>(8, vector<POS_T>(8, 0)), false};
+        stringstream ss(fen);
+        string part;
+        if (!getline(ss, part, ':') || (part != "W" && part != "B"))
+            throw runtime_error("bad FEN side to move in '" + fen + "'");
+        pos.color = (part == "B");
+        while (getline(ss, part, ':'))
+        {
+            // Точка в конце FEN в формате PDN необязательна
+            if (!part.empty() && part.back() == '.')
+                part.pop_back();
+            if (part.empty() || (part[0] != 'W' && part[0] != 'B'))
+                throw runtime_error("bad FEN piece list '" + part + "'");
+            const POS_T man = (part[0] == 'W' ? 1 : 2);
+            stringstream pieces(part.substr(1));
+            string cell;
+            while (getline(pieces, cell, ','))
+            {
+                if (cell.empty())
+                    continue;
+                const bool is_queen = (cell[0] == 'K');
+                auto xy = parse_square(is_queen ? cell.substr(1) : cell);
+                pos.mtx[xy.first][xy.second] = man + (is_queen ? 2 : 0);
+            }
+        }
+        return pos;
+    }
+
+    // Запись позиции в FEN
+    static string to_fen(const game_position &pos)
+    {
+        string res = pos.color ? "B" : "W";
+        for (POS_T man = 1; man <= 2; ++man)
+        {
+            res += (man == 1 ? ":W" : ":B");
+            bool is_first = true;
+            // Клетки перечисляются от a1 к h8
+            for (POS_T y = 0; y < 8; ++y)
+            {
+                for (POS_T x = 7; x >= 0; --x)
+                {
+                    if (!pos.mtx[x][y] || (pos.mtx[x][y] - 1) % 2 != man - 1)
+                        continue;
+                    if (!is_first)
+                        res += ",";
+                    is_first = false;
+                    res += (pos.mtx[x][y] > 2 ? "K" : "") + square(x, y);
+                }
+            }
+        }
+        return res;
+    }
+
+    // Запись полного хода, например "c3-d4" или "c3:e5:c7"
+    static string move_to_string(const vector<move_pos> &path)
+    {
+        string res = square(path.front().x, path.front().y);
+        for (const auto &turn : path)
+            res += (turn.xb != -1 ? ":" : "-") + square(turn.x2, turn.y2);
+        return res;
+    }
+
+    // Разбор полного хода в позиции pos
+    // Ход ищется среди разрешенных: серия взятий может быть записана целиком
+    // или только начальной и конечной клеткой, если это не оставляет неоднозначности
+    // Бросает runtime_error, если такого хода нет или он неоднозначен
+    static move_chain parse_move(Logic &logic, const game_position &pos, const string &text)
+    {
+        vector<pair<POS_T, POS_T>> cells;
+        string cell;
+        for (char c : text + "-")
+        {
+            if (c == '-' || c == ':' || c == 'x')
+            {
+                cells.push_back(parse_square(cell));
+                cell.clear();
+            }
+            else
+                cell += c;
+        }
+        if (cells.size() < 2)
+            throw runtime_error("bad move '" + text + "'");
+
+        const move_chain *found = nullptr;
+        auto chains = logic.find_chains(pos.color, pos.mtx);
+        for (const auto &chain : chains)
+        {
+            if (chain.x() != cells.front().first || chain.y() != cells.front().second ||
+                chain.x2() != cells.back().first || chain.y2() != cells.back().second)
+                continue;
+            // Полная запись серии взятий должна совпадать с путем хода
+            if (cells.size() > 2)
+            {
+                bool same = (cells.size() == chain.path.size() + 1);
+                for (size_t i = 0; same && i < chain.path.size(); ++i)
+                    same = (chain.path[i].x2 == cells[i + 1].first && chain.path[i].y2 == cells[i + 1].second);
+                if (!same)
+                    continue;
+            }
+            if (found)
+                throw runtime_error("ambiguous move '" + text + "'");
+            found = &chain;
+        }
+        if (!found)
+            throw runtime_error("illegal move '" + text + "' in " + to_fen(pos));
+        return *found;
+    }
+
+    // Выполняет полный ход в позиции
+    static game_position make_move(Logic &logic, const game_position &pos, const move_chain &chain)
+    {
+        return game_position{logic.make_turn(pos.mtx, chain), !pos.color};
+    }
+
+    // Разбор строки вида "<FEN|startpos> [moves <ход> <ход> ...]"
+    // Возвращает позицию после всех ходов
+    static game_position parse_position(Logic &logic, const string &line)
+    {
+        stringstream ss(line);
+        string token;
+        ss >> token;
+        game_position pos =
+            (token == "startpos") ? game_position{Board::start_mtx(), false} : parse_fen(token);
+        if (ss >> token && token != "moves")
+            throw runtime_error("expected 'moves' after position, got '" + token + "'");
+        while (ss >> token)
+            pos = make_move(logic, pos, parse_move(logic, pos, token));
+        return pos;
+    }
+
+    // Партия в формате PDN: начальная позиция, ходы и результат
+    struct pdn_game
+    {
+        game_position start;        // Начальная позиция (тег FEN или начальная расстановка)
+        vector<move_chain> moves;   // Полные ходы партии
+        string result = "*";        // Результат: "1-0", "0-1", "1/2-1/2" или "*"
+    };
+
+    // Разбор партии в формате PDN
+    // Поддерживаются теги (учитывается только FEN), номера ходов, комментарии в фигурных скобках
+    // и результат в конце партии
+    static pdn_game parse_pdn(Logic &logic, const string &text)
+    {
+        pdn_game game{game_position{Board::start_mtx(), false}, {}, "*"};
+        string body;
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            if (text[i] == '[')  // Тег: [Имя "значение"]
+            {
+                size_t end = text.find(']', i);
+                if (end == string::npos)
+                    throw runtime_error("unterminated PDN tag");
+                string tag = text.substr(i + 1, end - i - 1);
+                size_t q1 = tag.find('"'), q2 = tag.rfind('"');
+                if (tag.compare(0, 3, "FEN") == 0 && q1 != string::npos && q2 > q1)
+                    game.start = parse_fen(tag.substr(q1 + 1, q2 - q1 - 1));
+                i = end;
+            }
+            else if (text[i] == '{')  // Комментарий
+            {
+                i = text.find('}', i);
+                if (i == string::npos)
+                    throw runtime_error("unterminated PDN comment");
+            }
+            else
+                body += text[i];
+        }
+
+        game_position pos = game.start;
+        stringstream ss(body);
+        string token;
+        while (ss >> token)
+        {
+            if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "2-0" || token == "0-2" ||
+                token == "1-1" || token == "*")
+            {
+                game.result = token;
+                break;
+            }
+            // Номер хода "12." или "12..." может стоять отдельно или слитно с ходом
+            size_t dot = token.find_last_of('.');
+            if (dot != string::npos)
+                token = token.substr(dot + 1);
+            if (token.empty())
+                continue;
+            game.moves.push_back(parse_move(logic, pos, token));
+            pos = make_move(logic, pos, game.moves.back());
+        }
+        return game;
+    }
+
+    // Запись партии в формате PDN (тип игры 25 - русские шашки)
+    static string write_pdn(const pdn_game &game)
+    {
+        string res = "[GameType \"25\"]\n";
+        res += "[FEN \"" + to_fen(game.start) + "\"]\n";
+        res += "[Result \"" + game.result + "\"]\n";
+        int move_num = 1;
+        bool color = game.start.color;
+        if (color)
+            res += "1... ";
+        for (const auto &chain : game.moves)
+        {
+            if (!color)
+                res += to_string(move_num) + ". ";
+            res += move_to_string(chain.path) + " ";
+            if (color)
+                ++move_num;
+            color = !color;
+        }
+        return res + game.result + "\n";
+    }
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+
+// Разбор числовых параметров командной строки
+// Запись проверяется целиком: "", "12x", " 5" и числа вне допустимых пределов отвергаются,
+// вместо того чтобы завершать программу исключением из stoi
+class Options
+{
+  public:
+    // Разбор числа value в пределах [min_value, max_value]
+    // Возвращает true и записывает число в result, если запись верна; иначе result не меняется
+    template <class T>
+    static bool parse_number(const std::string &value, T &result, const T min_value, const T max_value)
+    {
+        T parsed{};
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            // strtod пропускает начальные пробелы, поэтому запись должна начинаться с цифры, знака или точки
+            if (value.empty() || std::isspace(static_cast<unsigned char>(value[0])))
+                return false;
+            char *end = nullptr;
+            parsed = static_cast<T>(std::strtod(value.c_str(), &end));
+            if (end != value.c_str() + value.size() || !std::isfinite(parsed))
+                return false;
+        }
+        else
+        {
+            const char *const last = value.data() + value.size();
+            const auto [ptr, error] = std::from_chars(value.data(), last, parsed);
+            if (error != std::errc() || ptr != last)
+                return false;
+        }
+        if (parsed < min_value || parsed > max_value)
+            return false;
+        result = parsed;
+        return true;
+    }
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "Logic.h"
+#include "Notation.h"
+#include "Options.h"
+
+// Проверка генератора ходов (режим "perft"): число позиций на каждой глубине от начальной
+// расстановки варианта или от заданной позиции. Полный ход (вся серия взятий) считается одним ходом, ходы с одинаковой
+// итоговой позицией объединяются. Числа сравниваются с известными для варианта, поэтому
+// любое изменение генератора или правил варианта сразу видно
+class Perft
+{
+  public:
+    // Запуск проверки
+    // Параметры командной строки: [глубина] [вариант или позиция], например "perft 7 international"
+    // (по умолчанию глубина 6, вариант "russian" - русские шашки 8x8, "international" - 10x10)
+    // Вместо варианта можно указать позицию русских шашек в FEN, например позицию с дамками
+    // для проверки скорости генерации ходов дамок
+    // Возвращает 0 при успехе, 1 при ошибке в параметрах
+    int run(const int argc, char *argv[]) const
+    {
+        int depth = 6;
+        if (argc > 0 && !Options::parse_number(string(argv[0]), depth, 1, 30))
+        {
+            cerr << "perft: bad depth '" << argv[0] << "'" << endl;
+            cerr << "perft: usage: perft [depth 1..30] [russian|international|FEN]" << endl;
+            return 1;
+        }
+        const string variant = argc > 1 ? argv[1] : "russian";
+        if (variant == "russian")
+            return run_variant<RussianRules>(depth, {Board::start_mtx<RussianRules>(), false});
+        if (variant == "international")
+            return run_variant<InternationalRules>(depth, {Board::start_mtx<InternationalRules>(), false});
+        if (variant.find(':') != string::npos)
+        {
+            game_position pos;
+            try
+            {
+                pos = Notation::parse_fen(variant);
+            }
+            catch (const exception &e)
+            {
+                cerr << "perft: " << e.what() << endl;
+                return 1;
+            }
+            return run_variant<RussianRules>(depth, pos);
+        }
+        cerr << "perft: unknown variant " << variant << endl;
+        return 1;
+    }
+
+  private:
+    template <class Rules> int run_variant(const int depth, const game_position &pos) const
+    {
+        Config config(json{{"Bot", {{"NoRandom", true}, {"BotScoringType", "Number"}, {"Optimization", "O1"}}}});
+        BasicLogic<Rules> logic(nullptr, &config);
+        cout << "Board : " << Rules::SIZE << "x" << Rules::SIZE << "\n";
+        const auto total_start = chrono::steady_clock::now();
+        for (int d = 1; d <= depth; ++d)
+        {
+            const auto start = chrono::steady_clock::now();
+            const uint64_t nodes = logic.perft(pos.mtx, pos.color, d);
+            const auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+            cout << "Depth " << setw(2) << d << ": " << setw(12) << nodes << "  (" << ms << " ms)" << endl;
+        }
+        cout << "Total time (ms) : "
+             << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - total_start).count() << endl;
+        return 0;
+    }
+};
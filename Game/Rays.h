@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+
+#include "Rules.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Диагональные лучи черных клеток для генерации ходов дамок
+// Для каждой клетки и каждого из четырех направлений при компиляции строится маска клеток
+// луча (без самой клетки). Ближайшая занятая клетка луча - младший или старший бит
+// пересечения луча с маской занятых клеток, поэтому ходы дамки и взятия находятся несколькими
+// операциями с масками вместо обхода диагонали с проверкой границ
+// Номера клеток растут вместе с номером строки, поэтому на лучах вниз (к строке LAST) ближняя
+// клетка - младший бит, а на лучах вверх - старший
+// Параметр Rules - вариант правил (см. Rules.h)
+template <class Rules> class Rays
+{
+  public:
+    typedef typename Rules::Bits Bits;
+
+    // Направления в порядке обхода: (-1, -1), (-1, +1), (+1, -1), (+1, +1)
+    static constexpr POS_T DI[4] = {-1, -1, 1, 1};
+    static constexpr POS_T DJ[4] = {-1, 1, -1, 1};
+
+    // Маска клеток луча из клетки sq в направлении dir
+    static Bits ray(const int sq, const int dir)
+    {
+        return tables.rays[sq][dir];
+    }
+
+    // Клетки луча ближе первой занятой (до края доски, если занятых нет)
+    static Bits free_part(const int sq, const int dir, const Bits occupied)
+    {
+        const Bits r = tables.rays[sq][dir];
+        const Bits blockers = r & occupied;
+        if (!blockers)
+            return r;
+        const int b = nearest(blockers, dir);
+        return r ^ tables.rays[b][dir] ^ (Bits(1) << b);
+    }
+
+    // Ближайшая к началу луча клетка из непустой маски клеток луча направления dir
+    static int nearest(const Bits mask, const int dir)
+    {
+        return DI[dir] > 0 ? lowest(mask) : highest(mask);
+    }
+
+    // Строка и столбец клетки с номером sq
+    static POS_T row(const int sq)
+    {
+        return tables.rows[sq];
+    }
+    static POS_T col(const int sq)
+    {
+        return tables.cols[sq];
+    }
+
+    // Номер младшего и старшего установленного бита (маска не пуста)
+    static int lowest(const Bits mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, uint64_t(mask));
+        return int(index);
+#else
+        return __builtin_ctzll(uint64_t(mask));
+#endif
+    }
+    static int highest(const Bits mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, uint64_t(mask));
+        return int(index);
+#else
+        return 63 - __builtin_clzll(uint64_t(mask));
+#endif
+    }
+
+  private:
+    struct Tables
+    {
+        Bits rays[Rules::SQUARES][4];
+        POS_T rows[Rules::SQUARES];
+        POS_T cols[Rules::SQUARES];
+    };
+
+    static constexpr Tables make_tables()
+    {
+        Tables t{};
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
+        {
+            for (POS_T j = (i + 1) % 2; j < Rules::SIZE; j += 2)
+            {
+                const int sq = Rules::square(i, j);
+                t.rows[sq] = i;
+                t.cols[sq] = j;
+                for (int dir = 0; dir < 4; ++dir)
+                {
+                    Bits r = 0;
+                    for (POS_T i2 = i + DI[dir], j2 = j + DJ[dir]; Rules::inside(i2, j2); i2 += DI[dir], j2 += DJ[dir])
+                        r |= Bits(1) << Rules::square(i2, j2);
+                    t.rays[sq][dir] = r;
+                }
+            }
+        }
+        return t;
+    }
+
+    static constexpr Tables tables = make_tables();
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+#include "../Models/Move.h"
+
+// Геометрия доски и правила варианта шашек, известные при компиляции
+// Логика, хеширование и пакетная оценка параметризуются одним из этих классов (Logic - русские
+// шашки 8x8), поэтому каждый вариант компилируется в свой генератор ходов и поиск,
+// где размер доски и правила - константы, а не проверки во время игры
+// Черные клетки: (i + j) нечетно, белые шашки стоят в нижних строках и идут к строке 0
+template <int N> struct board_geometry
+{
+    static constexpr int SIZE = N;              // Число строк и столбцов
+    static constexpr int LAST = N - 1;          // Номер последней строки (столбца)
+    static constexpr int HALF = N / 2;          // Число черных клеток в строке
+    static constexpr int SQUARES = N * N / 2;   // Число черных клеток
+
+    // Маска черных клеток: 32 бита для 8x8, 64 бита для 10x10
+    typedef typename std::conditional<(SQUARES <= 32), uint32_t, uint64_t>::type Bits;
+
+    // Номер черной клетки (i, j) по строкам: каждая строка занимает HALF подряд идущих номеров
+    static constexpr int square(const POS_T i, const POS_T j)
+    {
+        return i * HALF + j / 2;
+    }
+
+    // Лежит ли клетка (i, j) на доске
+    static constexpr bool inside(const POS_T i, const POS_T j)
+    {
+        return i >= 0 && i <= LAST && j >= 0 && j <= LAST;
+    }
+
+    // Строка превращения шашки типа type (1 - белая, 2 - черная)
+    static constexpr POS_T promotion_row(const POS_T type)
+    {
+        return type == 1 ? 0 : LAST;
+    }
+};
+
+// Русские шашки: доска 8x8, по 12 шашек, шашка бьет назад, дамка дальнобойная,
+// шашка, дошедшая до последней строки во время взятия, продолжает бить уже как дамка,
+// из нескольких взятий можно выбрать любое
+struct RussianRules : board_geometry<8>
+{
+    static constexpr int START_ROWS = 3;                // Число строк с шашками каждой стороны в начале
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;  // Шашка бьет и назад
+    static constexpr bool FLYING_KINGS = true;          // Дамка ходит и бьет на любое расстояние
+    static constexpr bool PROMOTE_IN_CAPTURE = true;    // Превращение в середине серии взятий
+    static constexpr bool MAX_CAPTURE = false;          // Обязательно взятие наибольшего числа шашек
+};
+
+// Международные шашки: доска 10x10, по 20 шашек, шашка бьет назад, дамка дальнобойная,
+// обязательно взятие наибольшего числа шашек, шашка превращается в дамку, только если
+// заканчивает ход на последней строке (проходя ее во время взятия, она остается шашкой)
+struct InternationalRules : board_geometry<10>
+{
+    static constexpr int START_ROWS = 4;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool PROMOTE_IN_CAPTURE = false;
+    static constexpr bool MAX_CAPTURE = true;
+};
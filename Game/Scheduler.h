@@ -0,0 +1,343 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#ifdef __cpp_impl_coroutine
+#include <coroutine>
+#endif
+
+#include "Coroutine.h"
+#include "Logic.h"
+
+// Поиск хода, выполняемый планировщиком (см. SearchScheduler) квантами по числу позиций
+// Создается через SearchScheduler::submit; ready, wait, result и cancel можно вызывать из любого потока
+class SearchTask
+{
+  public:
+    // Поиск закончен (в том числе отменен)
+    bool ready() const
+    {
+        return done.load(memory_order_acquire);
+    }
+
+    // Ожидание окончания поиска (только для планировщика с рабочими потоками)
+    void wait()
+    {
+        unique_lock<mutex> lock(done_mtx);
+        finished.wait(lock, [this] { return ready(); });
+    }
+
+    // Результат поиска: последняя завершенная итерация (best пуст, если ходов нет
+    // или поиск отменен до первой итерации). Можно читать после ready
+    const search_info &result() const
+    {
+        return info;
+    }
+
+    // Отмена поиска: текущая итерация прерывается, задача заканчивается в следующем кванте
+    void cancel()
+    {
+        cancelled.store(true, memory_order_relaxed);
+    }
+
+  private:
+    friend class SearchScheduler;
+    friend class SearchAwaiter;
+
+    // Вызов continuation в потоке, выполнившем последний квант, когда поиск закончится
+    // Возвращает false, если поиск уже закончен (continuation не вызывается)
+    bool then(function<void()> continuation)
+    {
+        lock_guard<mutex> lock(done_mtx);
+        if (ready())
+            return false;
+        this->continuation = std::move(continuation);
+        return true;
+    }
+
+    Logic *logic;
+    vector<vector<POS_T>> mtx;
+    bool color;
+    vector<vector<vector<POS_T>>> history;
+    search_limits limits;
+    int priority;
+    chrono::steady_clock::time_point deadline;  // Срок ответа (max - без ограничения времени)
+    function<void(const search_info &)> on_done;
+    function<void(const search_info &)> on_iteration;
+
+    unique_ptr<Coroutine> coroutine;  // Поиск, приостановленный между квантами (nullptr - не начат)
+    uint64_t quantum_end = 0;         // Число позиций поиска, после которого квант заканчивается
+    search_info info;
+    atomic<bool> cancelled{false};
+    atomic<bool> done{false};
+    mutex done_mtx;
+    condition_variable finished;
+    function<void()> continuation;  // См. then
+};
+
+#ifdef __cpp_impl_coroutine
+// Ожидание поиска в сопрограмме C++20: search_info info = co_await SearchAwaiter(task)
+// (или co_await scheduler.find_best_turns(...)). Сопрограмма продолжается в потоке, выполнившем
+// последний квант поиска: без рабочих потоков - внутри run_one
+class SearchAwaiter
+{
+  public:
+    explicit SearchAwaiter(shared_ptr<SearchTask> task) : task(std::move(task))
+    {
+    }
+
+    bool await_ready() const
+    {
+        return task->ready();
+    }
+
+    bool await_suspend(const coroutine_handle<> handle)
+    {
+        return task->then([handle] { handle.resume(); });
+    }
+
+    search_info await_resume() const
+    {
+        return task->result();
+    }
+
+  private:
+    shared_ptr<SearchTask> task;
+};
+#endif
+
+// Планировщик, чередующий много поисков хода на фиксированном числе потоков
+// Каждый поиск (Logic::search по шагам) идет в своей сопрограмме (см. Coroutine.h) квантами:
+// после quantum_nodes позиций поиск приостанавливается посреди итерации углубления (в проверке
+// ограничений, Logic::on_yield) и задача возвращается в очередь, а следующий квант продолжает его
+// с того же места, возможно в другом потоке. Поток на каждый поиск не нужен: приостановленный
+// поиск занимает только свой стек
+// Из очереди первой берется задача с большим приоритетом, при равных приоритетах - с более ранним
+// сроком ответа (начало поиска + limits.time_ms), при равных сроках - ждущая дольше всех,
+// поэтому одинаковые задачи чередуются по кругу
+// Без рабочих потоков (threads = 0) кванты выполняет вызывающий поток через run_one: так окно
+// игры между квантами поиска обрабатывает события в одном потоке
+// Экземпляр Logic задачи не должен использоваться ничем другим, пока задача не закончена
+class SearchScheduler
+{
+  public:
+    // Число позиций в кванте по умолчанию (порядка 10 мс поиска)
+    static constexpr uint64_t QUANTUM_NODES = 16384;
+
+    // Параметры:
+    // threads - число рабочих потоков (0 - кванты выполняются только через run_one)
+    // quantum_nodes - число позиций поиска в кванте (проверяется через каждые 1024 позиции)
+    explicit SearchScheduler(const size_t threads, const uint64_t quantum_nodes = QUANTUM_NODES)
+        : quantum_nodes(quantum_nodes)
+    {
+        for (size_t i = 0; i < threads; ++i)
+            workers.emplace_back([this] { work(); });
+    }
+
+    SearchScheduler(const SearchScheduler &) = delete;
+    SearchScheduler &operator=(const SearchScheduler &) = delete;
+
+    // Остановка: незаконченные задачи отменяются и заканчиваются с найденным на этот момент результатом
+    ~SearchScheduler()
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        has_task.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+        while (!ready.empty())
+        {
+            auto task = ready.top().task;
+            ready.pop();
+            task->cancel();
+            while (!run(task))
+            {
+            }
+        }
+    }
+
+    // Постановка поиска в очередь
+    // Параметры:
+    // logic - логика, которая выполняет поиск (должна существовать до окончания задачи)
+    // mtx, color, history, limits - как в Logic::search
+    // priority - приоритет (больше - раньше)
+    // on_done - вызывается по окончании поиска в потоке, выполнившем последний квант
+    // on_iteration - вызывается после каждой завершенной итерации в потоке, выполнившем квант
+    // (внутри сопрограммы поиска)
+    shared_ptr<SearchTask> submit(Logic &logic, const vector<vector<POS_T>> &mtx, const bool color,
+                                  const vector<vector<vector<POS_T>>> &history, const search_limits &limits,
+                                  const int priority = 0, function<void(const search_info &)> on_done = nullptr,
+                                  function<void(const search_info &)> on_iteration = nullptr)
+    {
+        auto task = make_shared<SearchTask>();
+        task->logic = &logic;
+        task->mtx = mtx;
+        task->color = color;
+        task->history = history;
+        task->limits = limits;
+        task->priority = priority;
+        task->deadline = limits.time_ms ? chrono::steady_clock::now() + chrono::milliseconds(limits.time_ms)
+                                        : chrono::steady_clock::time_point::max();
+        task->on_done = std::move(on_done);
+        task->on_iteration = std::move(on_iteration);
+        push(task);
+        return task;
+    }
+
+#ifdef __cpp_impl_coroutine
+    // Поиск хода, который можно ожидать в сопрограмме C++20 (аналог Logic::find_best_turns):
+    // search_info info = co_await scheduler.find_best_turns(logic, mtx, color, history, limits);
+    // Параметры - как в submit
+    SearchAwaiter find_best_turns(Logic &logic, const vector<vector<POS_T>> &mtx, const bool color,
+                                  const vector<vector<vector<POS_T>>> &history, const search_limits &limits,
+                                  const int priority = 0)
+    {
+        return SearchAwaiter(submit(logic, mtx, color, history, limits, priority));
+    }
+#endif
+
+    // Выполнение одного кванта в вызывающем потоке
+    // Возвращает false, если очередь пуста
+    bool run_one()
+    {
+        shared_ptr<SearchTask> task;
+        {
+            lock_guard<mutex> lock(mtx);
+            if (ready.empty())
+                return false;
+            task = ready.top().task;
+            ready.pop();
+        }
+        if (!run(task))
+            push(task);
+        return true;
+    }
+
+    // Число задач в очереди (без выполняющихся в этот момент квантов)
+    size_t pending()
+    {
+        lock_guard<mutex> lock(mtx);
+        return ready.size();
+    }
+
+  private:
+    // Элемент очереди
+    struct Entry
+    {
+        int priority;
+        chrono::steady_clock::time_point deadline;
+        uint64_t seq;  // Номер постановки в очередь
+        shared_ptr<SearchTask> task;
+
+        // Порядок priority_queue: наверху элемент, который меньше всех остальных по этому сравнению
+        bool operator<(const Entry &other) const
+        {
+            if (priority != other.priority)
+                return priority < other.priority;
+            if (deadline != other.deadline)
+                return deadline > other.deadline;
+            return seq > other.seq;
+        }
+    };
+
+    void push(const shared_ptr<SearchTask> &task)
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            ready.push(Entry{task->priority, task->deadline, ++last_seq, task});
+        }
+        has_task.notify_one();
+    }
+
+    // Квант задачи. Возвращает true, если задача закончена
+    bool run(const shared_ptr<SearchTask> &task)
+    {
+        if (!task->coroutine)
+        {
+            // Отмененная до первого кванта задача заканчивается без поиска
+            if (task->cancelled.load(memory_order_relaxed))
+                return finish(task);
+            task->coroutine = make_unique<Coroutine>([this, t = task.get()] { search(*t); });
+        }
+        else
+            task->quantum_end = task->logic->nodes + quantum_nodes;
+        if (!task->coroutine->resume())
+            return false;
+        task->coroutine.reset();
+        return finish(task);
+    }
+
+    // Поиск задачи внутри ее сопрограммы: приостанавливается, когда квант исчерпан
+    void search(SearchTask &task)
+    {
+        Logic &logic = *task.logic;
+        // Отмена прерывает итерацию через флаг остановки логики
+        const atomic<bool> *stop_flag = logic.stop_flag;
+        function<void()> on_yield = std::move(logic.on_yield);
+        logic.stop_flag = &task.cancelled;
+        logic.on_yield = [&logic, &task] {
+            if (logic.nodes >= task.quantum_end)
+                task.coroutine->yield();
+        };
+        logic.begin_search(task.mtx, task.color, task.history, task.limits);
+        task.quantum_end = logic.nodes + quantum_nodes;
+        while (logic.search_step(task.on_iteration))
+        {
+        }
+        task.info = logic.end_search();
+        logic.stop_flag = stop_flag;
+        logic.on_yield = std::move(on_yield);
+    }
+
+    // Окончание задачи. Возвращает true
+    static bool finish(const shared_ptr<SearchTask> &task)
+    {
+        if (task->on_done)
+            task->on_done(task->info);
+        function<void()> continuation;
+        {
+            lock_guard<mutex> lock(task->done_mtx);
+            task->done.store(true, memory_order_release);
+            continuation = std::move(task->continuation);
+        }
+        task->finished.notify_all();
+        if (continuation)
+            continuation();
+        return true;
+    }
+
+    // Цикл рабочего потока
+    void work()
+    {
+        while (true)
+        {
+            shared_ptr<SearchTask> task;
+            {
+                unique_lock<mutex> lock(mtx);
+                has_task.wait(lock, [this] { return stopping || !ready.empty(); });
+                if (stopping)
+                    return;
+                task = ready.top().task;
+                ready.pop();
+            }
+            if (!run(task))
+                push(task);
+        }
+    }
+
+    vector<thread> workers;
+    mutex mtx;
+    condition_variable has_task;
+    priority_queue<Entry> ready;  // Задачи, ожидающие следующего кванта
+    uint64_t last_seq = 0;
+    bool stopping = false;
+    const uint64_t quantum_nodes;
+};
@@ -0,0 +1,278 @@
+#pragma once
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+
+#include "Archive.h"
+#include "Logic.h"
+#include "Notation.h"
+#include "Options.h"
+#include "ThreadPool.h"
+#include "TrainingData.h"
+
+// Генератор обучающих данных самоигрой (режим "selfplay") и просмотр данных (режим "dataset")
+// Партии бота с самим собой идут параллельно в пуле потоков. Первые ходы каждой партии
+// выбираются случайно, чтобы партии не повторялись, дальше каждая позиция ищется на заданную
+// глубину и записывается (позиция, очередь хода, оценка поиска) в файл обучающих данных.
+// Итог партии дописывается в записи после ее окончания, поэтому записи партии
+// попадают в файл вместе, когда партия закончена
+// Партия заканчивается как в игре: нет ходов - проигрыш, ничья по троекратному повторению,
+// 15 ходам только дамками или по достижении предела числа ходов
+class SelfPlay
+{
+  public:
+    // Запуск самоигры
+    // Параметры командной строки:
+    // --games N - число партий (по умолчанию 100)
+    // --threads N - число потоков (по умолчанию по числу ядер)
+    // --depth D - глубина поиска (по умолчанию 4)
+    // --nodes N - ограничение числа позиций поиска на ход (по умолчанию без ограничения)
+    // --random-plies K - число случайных ходов в начале партии (по умолчанию 6, не записываются)
+    // --max-plies M - предел числа ходов (полуходов) партии, после него ничья (по умолчанию 120)
+    // --seed S - начальное значение генератора случайных ходов (по умолчанию 1)
+    // --opt O - уровень оптимизации поиска (по умолчанию O2)
+    // --scoring S - режим оценки позиции (по умолчанию NumberAndPotential)
+    // --out FILE - файл обучающих данных, дополняется (по умолчанию selfplay.bin)
+    // --archive FILE - архив партий, в который дописываются партии целиком (по умолчанию не пишется)
+    // Возвращает 0 при успехе, 1 при ошибке в параметрах или в формате файлов
+    int run(const int argc, char *argv[])
+    {
+        uint64_t games = 100;
+        size_t threads = 0;
+        string out = "selfplay.bin", archive_path, optimization = "O2", scoring = "NumberAndPotential";
+        for (int i = 0; i + 1 < argc; i += 2)
+        {
+            string arg = argv[i], value = argv[i + 1];
+            bool valid = true;
+            if (arg == "--games")
+                valid = Options::parse_number(value, games, uint64_t(0), numeric_limits<uint64_t>::max());
+            else if (arg == "--threads")
+                valid = Options::parse_number(value, threads, size_t(0), size_t(1024));
+            else if (arg == "--depth")
+                valid = Options::parse_number(value, limits.depth, 1, 64);
+            else if (arg == "--nodes")
+                valid = Options::parse_number(value, limits.nodes, uint64_t(0), numeric_limits<uint64_t>::max());
+            else if (arg == "--random-plies")
+                valid = Options::parse_number(value, random_plies, 0, 1000);
+            else if (arg == "--max-plies")
+                valid = Options::parse_number(value, max_plies, 1, 10000);
+            else if (arg == "--seed")
+                valid = Options::parse_number(value, seed, uint64_t(0), numeric_limits<uint64_t>::max());
+            else if (arg == "--opt")
+                optimization = value;
+            else if (arg == "--scoring")
+                scoring = value;
+            else if (arg == "--out")
+                out = value;
+            else if (arg == "--archive")
+                archive_path = value;
+            else
+            {
+                cerr << "selfplay: unknown option " << arg << endl;
+                return 1;
+            }
+            if (!valid)
+            {
+                cerr << "selfplay: bad value '" << value << "' of " << arg << endl;
+                return 1;
+            }
+        }
+        if (argc % 2)
+        {
+            cerr << "selfplay: missing value for " << argv[argc - 1] << endl;
+            return 1;
+        }
+
+        config = Config(json{{"Bot", {{"NoRandom", true}, {"BotScoringType", scoring}, {"Optimization", optimization}}}});
+        unique_ptr<TrainingWriter> writer;
+        unique_ptr<ArchiveWriter> archive;
+        try
+        {
+            // Ошибка в настройках бота сообщается здесь, а не исключением в потоке партии
+            Logic check(nullptr, &config);
+            writer = make_unique<TrainingWriter>(out);
+            if (!archive_path.empty())
+                archive = make_unique<ArchiveWriter>(archive_path);
+        }
+        catch (const exception &e)
+        {
+            cerr << "selfplay: " << e.what() << endl;
+            return 1;
+        }
+        const auto start = chrono::steady_clock::now();
+        {
+            ThreadPool pool(threads, 4);
+            for (uint64_t id = 0; id < games; ++id)
+            {
+                pool.submit([this, id, games, &writer, &archive] {
+                    int result = 0;
+                    vector<vector<move_pos>> moves;
+                    writer->append(play_game(id, result, moves));
+                    if (archive)
+                        archive->append(moves, result);
+                    finish(result, games);
+                });
+            }
+            pool.wait();
+        }
+        const double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "Games     : " << games << " (white " << results[2] << ", draws " << results[1] << ", black "
+             << results[0] << ")\n";
+        cout << "Positions : " << writer->count() << "\n";
+        cout << "Time (s)  : " << int64_t(sec) << "\n";
+        cout << "Output    : " << out << endl;
+        if (archive)
+            cout << "Archive   : " << archive_path << " (" << archive->count() << " games)" << endl;
+        return 0;
+    }
+
+    // Просмотр файла обучающих данных
+    // Параметры командной строки: <файл> [--sample N] [--seed S]
+    // Выводит число записей, распределение итогов и N случайных записей (FEN, оценка, итог)
+    // Возвращает 0 при успехе, 1 при ошибке в параметрах
+    int inspect(const int argc, char *argv[]) const
+    {
+        if (argc < 1 || argc % 2 == 0)
+        {
+            cerr << "dataset: usage: dataset <file> [--sample N] [--seed S]" << endl;
+            return 1;
+        }
+        size_t sample = 10;
+        uint64_t sample_seed = 1;
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            string arg = argv[i], value = argv[i + 1];
+            bool valid = true;
+            if (arg == "--sample")
+                valid = Options::parse_number(value, sample, size_t(0), size_t(1) << 20);
+            else if (arg == "--seed")
+                valid = Options::parse_number(value, sample_seed, uint64_t(0), numeric_limits<uint64_t>::max());
+            else
+            {
+                cerr << "dataset: unknown option " << arg << endl;
+                return 1;
+            }
+            if (!valid)
+            {
+                cerr << "dataset: bad value '" << value << "' of " << arg << endl;
+                return 1;
+            }
+        }
+
+        TrainingReader reader(argv[0]);
+        uint64_t counts[3] = {0, 0, 0};  // Поражения, ничьи и победы ходящего игрока
+        double abs_score = 0;
+        reader.for_each([&](const training_record &rec) {
+            ++counts[rec.result + 1];
+            abs_score += abs(rec.score);
+        });
+        cout << "Records   : " << reader.size() << "\n";
+        cout << "Results   : win " << counts[2] << ", draw " << counts[1] << ", loss " << counts[0]
+             << " (side to move)\n";
+        cout << "Mean |score| : " << (reader.size() ? int64_t(abs_score / reader.size()) : 0) << "\n";
+        for (const auto &rec : reader.sample(sample, sample_seed))
+            cout << Notation::to_fen(to_position(rec)) << " score " << rec.score << " result " << int(rec.result)
+                 << "\n";
+        cout.flush();
+        return 0;
+    }
+
+    // Запись для позиции pos с оценкой поиска score (итог партии заполняется позже)
+    static training_record to_record(const game_position &pos, const int score)
+    {
+        const auto packed = BatchEval::pack(pos.mtx);
+        training_record rec;
+        rec.men[0] = packed.men[0];
+        rec.men[1] = packed.men[1];
+        rec.kings[0] = packed.kings[0];
+        rec.kings[1] = packed.kings[1];
+        rec.score = int16_t(max(-SCORE_SCALE, min(SCORE_SCALE, score)));
+        rec.color = pos.color;
+        rec.result = 0;
+        return rec;
+    }
+
+    // Позиция записи rec
+    static game_position to_position(const training_record &rec)
+    {
+        game_position pos{vector<vector<POS_T>>(8, vector<POS_T>(8, 0)), rec.color != 0};
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = (i + 1) % 2; j < 8; j += 2)
+            {
+                const uint32_t mask = uint32_t(1) << BatchEval::bit(i, j);
+                for (int c = 0; c < 2; ++c)
+                {
+                    if (rec.men[c] & mask)
+                        pos.mtx[i][j] = POS_T(1 + c);
+                    if (rec.kings[c] & mask)
+                        pos.mtx[i][j] = POS_T(3 + c);
+                }
+            }
+        }
+        return pos;
+    }
+
+  private:
+    // Одна партия самоигры
+    // Параметры:
+    // id - номер партии (определяет случайные начальные ходы)
+    // result - итог партии для белых: 1 - победа, 0 - ничья, -1 - поражение
+    // moves - ходы партии
+    // Возвращает записи позиций партии
+    vector<training_record> play_game(const uint64_t id, int &result, vector<vector<move_pos>> &moves)
+    {
+        Logic logic(nullptr, &config);
+        mt19937_64 rng(seed * 1000003 + id);
+        game_position pos{Board::start_mtx(), false};
+        vector<vector<vector<POS_T>>> history(1, pos.mtx);
+        vector<training_record> records;
+        result = 0;
+        for (int ply = 0; ply < max_plies && !Logic::is_draw_by_rules(history, 3, 15); ++ply)
+        {
+            const auto chains = logic.find_chains(pos.color, pos.mtx);
+            if (chains.empty())
+            {
+                result = pos.color ? 1 : -1;
+                break;
+            }
+            vector<move_pos> best;
+            if (ply < random_plies)
+                best = chains[uniform_int_distribution<size_t>(0, chains.size() - 1)(rng)].path;
+            else
+            {
+                const search_info info = logic.search(pos.mtx, pos.color, history, limits);
+                records.push_back(to_record(pos, info.score));
+                best = info.best;
+            }
+            for (const auto &turn : best)
+                pos.mtx = logic.make_turn(pos.mtx, turn);
+            pos.color = !pos.color;
+            history.push_back(pos.mtx);
+            moves.push_back(best);
+        }
+        for (auto &rec : records)
+            rec.result = int8_t(rec.color ? -result : result);
+        return records;
+    }
+
+    // Учет итога законченной партии и вывод хода генерации
+    void finish(const int result, const uint64_t games)
+    {
+        lock_guard<mutex> lock(progress_mtx);
+        ++results[result + 1];
+        const uint64_t done = results[0] + results[1] + results[2];
+        if (done % 100 == 0 || done == games)
+            cerr << "selfplay: " << done << "/" << games << " games" << endl;
+    }
+
+    Config config{json::object()};  // Настройки бота
+    search_limits limits{4, 0, 0};  // Ограничения поиска на ход
+    int random_plies = 6;           // Число случайных ходов в начале партии
+    int max_plies = 120;            // Предел числа ходов партии
+    uint64_t seed = 1;              // Начальное значение генератора случайных ходов
+    mutex progress_mtx;
+    uint64_t results[3] = {0, 0, 0};  // Число партий, выигранных черными, ничьих и выигранных белыми
+};
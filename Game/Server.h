@@ -0,0 +1,617 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "Difficulty.h"
+#include "Logic.h"
+#include "Notation.h"
+#include "Options.h"
+#include "Scheduler.h"
+#include "TransTable.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Игровой сервер для множества одновременных партий человека с ботом (режим "server")
+//
+// Сервер слушает локальный TCP-порт или Unix-сокет, каждое соединение - отдельная партия.
+// Ввод-вывод всех соединений обслуживает один поток (poll), а ходы бота ищет планировщик
+// (см. Scheduler.h) на ограниченном числе потоков с общей таблицей транспозиций
+// Справедливость: у партии не бывает больше одного ожидающего хода бота, а планировщик
+// выполняет поиски квантами по числу позиций, первым - поиск с самым ранним сроком ответа,
+// поэтому ни одна партия не может надолго занять потоки.
+// Время бота ограничено для каждой партии: на ход не больше movetime и не больше
+// десятой части оставшегося запаса времени партии (budget)
+// Партия заканчивается, когда у ходящего нет ходов или наступила ничья по правилам
+// (повторение позиции, ходы только дамками, см. Logic::is_draw_by_rules)
+// SIGINT и SIGTERM останавливают сервер: соединения закрываются, поиски ботов отменяются
+//
+// Команды клиента (по одной в строке):
+// new [white|black] [level N] - новая партия, человек играет указанным цветом (по умолчанию белыми),
+//                               N - уровень сложности бота (см. Difficulty.h)
+// move <ход>                  - ход человека
+// fen                         - текущая позиция
+// legal                       - список разрешенных ходов
+// stats                       - задержки ответов бота в этой партии (процентили, мс)
+// quit                        - закрыть соединение
+//
+// Ответы сервера:
+// ok <FEN>                    - команда выполнена, текущая позиция
+// legal <ход> ...             - разрешенные ходы
+// botmove <ход> <FEN>         - ход бота и позиция после него
+// gameover <1-0|0-1|1/2-1/2>  - партия закончена
+// stats moves N p50 X p90 Y p99 Z max W
+// error <описание>
+class Server
+{
+#ifdef _WIN32
+  public:
+    int run(const int, char *[])
+    {
+        cerr << "server: not supported on Windows" << endl;
+        return 1;
+    }
+#else
+  public:
+    // Запуск сервера
+    // Параметры командной строки:
+    // --port P - TCP-порт на 127.0.0.1 (по умолчанию 5555)
+    // --unix PATH - Unix-сокет вместо TCP
+    // --threads N - число потоков для ходов бота (по умолчанию по числу ядер)
+    // --hash MB - размер общей таблицы транспозиций (по умолчанию 64)
+    // --shared-hash NAME - таблица транспозиций в разделяемой памяти NAME, общая с другими процессами движка
+    // --movetime MS - максимальное время на ход бота (по умолчанию 500)
+    // --budget MS - запас времени бота на партию (по умолчанию 60000)
+    // --opt O - уровень оптимизации поиска (по умолчанию O2)
+    // --repetition N - ничья при повторении позиции N раз (по умолчанию 3, 0 - не учитывать)
+    // --king-moves N - ничья после N ходов каждой стороны только дамками без взятий (по умолчанию 15, 0 - не учитывать)
+    // Возвращает 1 при ошибке запуска, 0 после остановки сигналом
+    int run(const int argc, char *argv[])
+    {
+        int port = 5555;
+        string optimization = "O2", shared_hash;
+        size_t threads = 0, hash_mb = 64;
+        for (int i = 0; i + 1 < argc; i += 2)
+        {
+            string arg = argv[i], value = argv[i + 1];
+            bool valid = true;
+            if (arg == "--port")
+                valid = Options::parse_number(value, port, 1, 65535);
+            else if (arg == "--unix")
+                unix_path = value;
+            else if (arg == "--threads")
+                valid = Options::parse_number(value, threads, size_t(0), size_t(1024));
+            else if (arg == "--hash")
+                valid = Options::parse_number(value, hash_mb, size_t(1), size_t(65536));
+            else if (arg == "--shared-hash")
+                shared_hash = value;
+            else if (arg == "--movetime")
+                valid = Options::parse_number(value, move_time_ms, int64_t(1), int64_t(3600000));
+            else if (arg == "--budget")
+                valid = Options::parse_number(value, budget_ms, int64_t(0), int64_t(86400000));
+            else if (arg == "--opt")
+                optimization = value;
+            else if (arg == "--repetition")
+                valid = Options::parse_number(value, repetition_draw, 0, 1000);
+            else if (arg == "--king-moves")
+                valid = Options::parse_number(value, king_moves_draw, 0, 1000);
+            else
+            {
+                cerr << "server: unknown option " << arg << endl;
+                return 1;
+            }
+            if (!valid)
+            {
+                cerr << "server: bad value '" << value << "' of " << arg << endl;
+                return 1;
+            }
+        }
+        if (threads == 0)
+            threads = max(1u, thread::hardware_concurrency());
+
+        // Настройки бота проверяются до открытия сокета: ошибка в них - ошибка запуска
+        config = Config(json{{"Bot", {{"NoRandom", false},
+                                      {"BotScoringType", "NumberAndPotential"},
+                                      {"Optimization", optimization}}}});
+        try
+        {
+            io_logic = make_unique<Logic>(nullptr, &config);
+        }
+        catch (const exception &e)
+        {
+            cerr << "server: " << e.what() << endl;
+            return 1;
+        }
+
+        listen_fd = unix_path.empty() ? listen_tcp(port) : listen_unix(unix_path);
+        if (listen_fd < 0 || pipe(wake_pipe) != 0)
+        {
+            cerr << "server: can't listen: " << strerror(errno) << endl;
+            return 1;
+        }
+        set_nonblocking(wake_pipe[0]);
+
+        tt.resize(hash_mb);
+        if (!shared_hash.empty())
+        {
+            try
+            {
+                tt.attach(shared_hash, hash_mb);
+            }
+            catch (const exception &e)
+            {
+                cerr << "server: " << e.what() << endl;
+                return 1;
+            }
+        }
+        scheduler = make_unique<SearchScheduler>(threads);
+        cout << "server: listening on " << (unix_path.empty() ? "127.0.0.1:" + to_string(port) : unix_path)
+             << " with " << threads << " bot threads" << endl;
+
+        // Обработчик сигнала только выставляет флаг и будит поток ввода-вывода
+        signal_fd() = wake_pipe[1];
+        struct sigaction action = {};
+        action.sa_handler = on_signal;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+
+        serve();
+
+        shutdown();
+        return 0;
+    }
+
+  private:
+    // Партия одного соединения
+    struct Session
+    {
+        int fd = -1;
+        string in, out;                          // Буферы ввода и вывода
+        game_position pos;                       // Текущая позиция
+        vector<vector<vector<POS_T>>> history;   // Позиции после последнего необратимого хода
+        bool bot_color = true;                   // Цвет бота
+        int level = 6;                           // Уровень сложности бота
+        int64_t bank_ms = 0;                     // Оставшийся запас времени бота
+        bool busy = false;                       // Бот думает над ходом
+        bool started = false;                    // Партия начата командой new
+        chrono::steady_clock::time_point asked;  // Момент запроса хода бота
+        vector<double> latencies;                // Задержки ответов бота, мс
+        // Логика бота партии: таблицы истории и ожидаемый ответ соперника относятся к одной партии.
+        // Пока бот думает, ее держит и задача планировщика, поэтому закрытие соединения безопасно
+        shared_ptr<Logic> logic;
+        shared_ptr<SearchTask> task;             // Поиск хода бота
+    };
+
+    // Результат поиска хода бота
+    struct Result
+    {
+        uint64_t session_id;
+        vector<move_pos> best;  // Лучший ход (пуст, если ходов нет)
+        int64_t time_ms;        // Время поиска
+    };
+
+    // Цикл ввода-вывода: прием соединений, чтение команд, отправка ответов и результатов ботов
+    void serve()
+    {
+        vector<pollfd> fds;
+        vector<uint64_t> ids;
+        while (!stop_requested())
+        {
+            fds.assign({{listen_fd, POLLIN, 0}, {wake_pipe[0], POLLIN, 0}});
+            ids.assign(2, 0);
+            for (auto &it : sessions)
+            {
+                fds.push_back({it.second.fd, short(POLLIN | (it.second.out.empty() ? 0 : POLLOUT)), 0});
+                ids.push_back(it.first);
+            }
+            if (poll(fds.data(), fds.size(), -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                cerr << "server: poll failed: " << strerror(errno) << endl;
+                return;
+            }
+            if (fds[0].revents & POLLIN)
+                accept_sessions();
+            if (fds[1].revents & POLLIN)
+                deliver_results();
+            for (size_t i = 2; i < fds.size(); ++i)
+            {
+                auto it = sessions.find(ids[i]);
+                if (it == sessions.end())
+                    continue;
+                bool alive = true;
+                if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+                    alive = false;
+                if (alive && (fds[i].revents & POLLIN))
+                    alive = read_session(ids[i], it->second);
+                if (alive && (fds[i].revents & POLLOUT))
+                    alive = flush_session(it->second);
+                if (!alive)
+                    close_session(ids[i]);
+            }
+        }
+    }
+
+    // Остановка сервера: новые соединения не принимаются, открытые получают сообщение и закрываются,
+    // их поиски отменяются; планировщик дожидается отмененных поисков, и только потом таблица
+    // транспозиций отключается от разделяемой памяти
+    void shutdown()
+    {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        close(listen_fd);
+        if (!unix_path.empty())
+            unlink(unix_path.c_str());
+        while (!sessions.empty())
+        {
+            Session &session = sessions.begin()->second;
+            reply(session, "error server is shutting down");
+            flush_session(session);
+            close_session(sessions.begin()->first);
+        }
+        scheduler.reset();
+        tt.resize(1);
+        close(wake_pipe[0]);
+        close(wake_pipe[1]);
+        cout << "server: stopped" << endl;
+    }
+
+    // Флаг остановки сервера сигналом
+    static volatile sig_atomic_t &stop_requested()
+    {
+        static volatile sig_atomic_t flag = 0;
+        return flag;
+    }
+
+    // Конец канала пробуждения для обработчика сигнала
+    static int &signal_fd()
+    {
+        static int fd = -1;
+        return fd;
+    }
+
+    static void on_signal(int)
+    {
+        stop_requested() = 1;
+        const char byte = 0;
+        const ssize_t written = write(signal_fd(), &byte, 1);
+        (void)written;
+    }
+
+    // Прием всех ожидающих соединений
+    void accept_sessions()
+    {
+        while (true)
+        {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0)
+                return;
+            set_nonblocking(fd);
+            Session &session = sessions[++last_id];
+            session.fd = fd;
+        }
+    }
+
+    // Чтение данных соединения и выполнение полученных команд
+    // Возвращает false, если соединение нужно закрыть
+    bool read_session(const uint64_t id, Session &session)
+    {
+        char buf[4096];
+        while (true)
+        {
+            ssize_t n = read(session.fd, buf, sizeof(buf));
+            if (n == 0)
+                return false;
+            if (n < 0)
+                break;
+            session.in.append(buf, n);
+        }
+        size_t pos;
+        while ((pos = session.in.find('\n')) != string::npos)
+        {
+            string line = session.in.substr(0, pos);
+            session.in.erase(0, pos + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!command(id, session, line))
+                return false;
+        }
+        // Слишком длинная строка без перевода строки - некорректный клиент
+        return session.in.size() <= 4096 && flush_session(session);
+    }
+
+    // Выполнение команды клиента
+    // Возвращает false, если соединение нужно закрыть
+    bool command(const uint64_t id, Session &session, const string &line)
+    {
+        stringstream ss(line);
+        string cmd;
+        if (!(ss >> cmd))
+            return true;
+        try
+        {
+            if (cmd == "quit")
+                return false;
+            else if (cmd == "new")
+            {
+                if (session.busy)
+                    throw runtime_error("bot is thinking");
+                bool human_color = false;
+                string word;
+                while (ss >> word)
+                {
+                    if (word == "white" || word == "black")
+                        human_color = (word == "black");
+                    else if (word == "level" && ss >> session.level)
+                        session.level = max(0, min(session.level, 20));
+                    else
+                        throw runtime_error("bad new parameter '" + word + "'");
+                }
+                session.pos = game_position{Board::start_mtx(), false};
+                session.history.assign(1, session.pos.mtx);
+                session.bot_color = !human_color;
+                session.bank_ms = budget_ms;
+                session.started = true;
+                reply(session, "ok " + Notation::to_fen(session.pos));
+                if (session.bot_color == session.pos.color)
+                    ask_bot(id, session);
+            }
+            else if (cmd == "move")
+            {
+                string text;
+                ss >> text;
+                if (!session.started)
+                    throw runtime_error("no game, send 'new'");
+                if (session.busy || session.pos.color == session.bot_color)
+                    throw runtime_error("not your turn");
+                make_move(session, Notation::parse_move(*io_logic, session.pos, text));
+                reply(session, "ok " + Notation::to_fen(session.pos));
+                if (!check_game_over(session))
+                    ask_bot(id, session);
+            }
+            else if (cmd == "fen")
+                reply(session, "ok " + Notation::to_fen(session.pos));
+            else if (cmd == "legal")
+            {
+                string text = "legal";
+                for (const auto &chain : io_logic->find_chains(session.pos.color, session.pos.mtx))
+                    text += " " + Notation::move_to_string(chain.path);
+                reply(session, text);
+            }
+            else if (cmd == "stats")
+                reply(session, "stats " + percentiles(session.latencies));
+            else
+                throw runtime_error("unknown command '" + cmd + "'");
+        }
+        catch (const exception &e)
+        {
+            reply(session, string("error ") + e.what());
+        }
+        return true;
+    }
+
+    // Выполнение полного хода в партии
+    // История хранится только с последнего необратимого хода: более ранние позиции не повторятся
+    void make_move(Session &session, const move_chain &chain)
+    {
+        auto prev = session.pos.mtx;
+        session.pos = Notation::make_move(*io_logic, session.pos, chain);
+        if (!Logic::is_reversible(prev, session.pos.mtx))
+            session.history.clear();
+        session.history.push_back(session.pos.mtx);
+    }
+
+    // Проверка окончания партии: ничья по правилам или у ходящего игрока нет ходов
+    bool check_game_over(Session &session)
+    {
+        string result;
+        if (Logic::is_draw_by_rules(session.history, repetition_draw, king_moves_draw))
+            result = "1/2-1/2";
+        else if (io_logic->find_chains(session.pos.color, session.pos.mtx).empty())
+            result = session.pos.color ? "1-0" : "0-1";
+        else
+            return false;
+        reply(session, "gameover " + result);
+        session.started = false;
+        return true;
+    }
+
+    // Постановка поиска хода бота в планировщик
+    // Планировщик чередует кванты поисков всех партий на потоках ботов: первым идет поиск
+    // с самым ранним сроком ответа, поэтому долгий поиск одной партии не задерживает остальные
+    void ask_bot(const uint64_t id, Session &session)
+    {
+        const auto profile = Difficulty::level(session.level);
+        search_limits limits = Difficulty::limits(profile);
+        limits.time_ms = max<int64_t>(1, min({profile.time_ms, move_time_ms, session.bank_ms / 10}));
+        session.busy = true;
+        session.asked = chrono::steady_clock::now();
+        if (!session.logic)
+        {
+            session.logic = make_shared<Logic>(nullptr, &config);
+            session.logic->tt = &tt;
+        }
+        session.logic->eval_noise = profile.noise;
+        auto logic = session.logic;
+        session.task = scheduler->submit(*logic, session.pos.mtx, session.pos.color, session.history, limits, 0,
+                                         [this, id, logic](const search_info &info) {
+                                             {
+                                                 lock_guard<mutex> lock(results_mtx);
+                                                 results.push_back(Result{id, info.best, info.time_ms});
+                                             }
+                                             char byte = 1;
+                                             if (write(wake_pipe[1], &byte, 1) < 0)
+                                                 cerr << "server: can't wake io thread" << endl;
+                                         });
+    }
+
+    // Применение найденных ходов ботов к партиям (в потоке ввода-вывода)
+    void deliver_results()
+    {
+        char buf[256];
+        while (read(wake_pipe[0], buf, sizeof(buf)) > 0)
+        {
+        }
+        deque<Result> ready;
+        {
+            lock_guard<mutex> lock(results_mtx);
+            ready.swap(results);
+        }
+        for (auto &result : ready)
+        {
+            auto it = sessions.find(result.session_id);
+            if (it == sessions.end())  // Соединение уже закрыто
+                continue;
+            Session &session = it->second;
+            session.busy = false;
+            session.task.reset();
+            session.bank_ms = max<int64_t>(0, session.bank_ms - result.time_ms);
+            session.latencies.push_back(
+                chrono::duration<double, milli>(chrono::steady_clock::now() - session.asked).count());
+            if (!result.best.empty())
+            {
+                // Ход бота выполняется по найденному пути, а не по записи: при случайном порядке
+                // ходов равнозначные пути дамки через разные клетки могут отличаться у разных экземпляров логики
+                move_chain chain{result.best, {}};
+                for (const auto &turn : chain.path)
+                    chain.captured.emplace_back(turn.xb, turn.yb);
+                make_move(session, chain);
+                reply(session, "botmove " + Notation::move_to_string(chain.path) + " " + Notation::to_fen(session.pos));
+            }
+            check_game_over(session);
+            if (!flush_session(session))
+                close_session(result.session_id);
+        }
+    }
+
+    // Добавление строки ответа в буфер вывода соединения
+    void reply(Session &session, const string &text)
+    {
+        session.out += text + "\n";
+    }
+
+    // Отправка буфера вывода, сколько примет сокет
+    // Возвращает false при ошибке соединения
+    bool flush_session(Session &session)
+    {
+        while (!session.out.empty())
+        {
+            ssize_t n = send(session.fd, session.out.data(), session.out.size(), MSG_NOSIGNAL);
+            if (n < 0)
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            session.out.erase(0, n);
+        }
+        return true;
+    }
+
+    // Закрытие соединения с выводом статистики задержек партии
+    void close_session(const uint64_t id)
+    {
+        auto it = sessions.find(id);
+        if (it == sessions.end())
+            return;
+        if (!it->second.latencies.empty())
+            cout << "session " << id << " closed: " << percentiles(it->second.latencies) << endl;
+        // Бот больше не нужен: поиск заканчивается на ближайшей проверке ограничений
+        if (it->second.task)
+            it->second.task->cancel();
+        close(it->second.fd);
+        sessions.erase(it);
+    }
+
+    // Процентили задержек в миллисекундах
+    static string percentiles(vector<double> latencies)
+    {
+        if (latencies.empty())
+            return "moves 0";
+        sort(latencies.begin(), latencies.end());
+        auto at = [&latencies](const double q) {
+            return to_string(int64_t(latencies[min(latencies.size() - 1, size_t(q * latencies.size()))]));
+        };
+        return "moves " + to_string(latencies.size()) + " p50 " + at(0.5) + " p90 " + at(0.9) + " p99 " + at(0.99) +
+               " max " + to_string(int64_t(latencies.back()));
+    }
+
+    static void set_nonblocking(const int fd)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    // Открытие TCP-сокета на 127.0.0.1
+    static int listen_tcp(const int port)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(uint16_t(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        set_nonblocking(fd);
+        return fd;
+    }
+
+    // Открытие Unix-сокета
+    static int listen_unix(const string &path)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(path.c_str());
+        if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        set_nonblocking(fd);
+        return fd;
+    }
+
+    int64_t move_time_ms = 500;        // Максимальное время на ход бота
+    int64_t budget_ms = 60000;         // Запас времени бота на партию
+    int repetition_draw = 3;           // Ничья при повторении позиции столько раз (0 - не учитывать)
+    int king_moves_draw = 15;          // Ничья после стольких ходов каждой стороны только дамками (0 - не учитывать)
+    string unix_path;                  // Путь Unix-сокета (пустой - TCP)
+    int listen_fd = -1;
+    int wake_pipe[2] = {-1, -1};       // Пробуждение потока ввода-вывода потоками ботов
+    Config config{json::object()};     // Настройки бота
+    TransTable tt{1};                  // Общая таблица транспозиций всех партий
+    unique_ptr<Logic> io_logic;        // Логика для разбора ходов в потоке ввода-вывода
+    map<uint64_t, Session> sessions;   // Партии по номеру соединения
+    uint64_t last_id = 0;
+
+    unique_ptr<SearchScheduler> scheduler;  // Поиски ходов ботов всех партий
+
+    mutex results_mtx;
+    deque<Result> results;             // Найденные ходы ботов
+#endif
+};
@@ -0,0 +1,452 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "../Models/Proof.h"
+#include "Arena.h"
+#include "Logic.h"
+#include "Notation.h"
+#include "Options.h"
+
+// Решатель: доказательство выигрыша или проигрыша позиции поиском по числам доказательства
+// в глубину (df-pn). В отличие от поиска бота решатель не оценивает позиции: позиция доказана,
+// только если у проигравшей стороны при любой игре не остается ходов
+//
+// Для каждой позиции хранятся два числа с точки зрения ходящего: phi - сколько листьев
+// нужно раскрыть, чтобы доказать его успех, и delta - чтобы его опровергнуть. Раскрывается
+// самый дешевый для доказательства потомок, пока числа узла не превысят пороги, полученные от родителя
+// Числа хранятся в таблице ограниченного размера (по две записи в корзине, вытесняется запись
+// с меньшей работой), поэтому поиск не выходит за отведенную память, а перебор прерывается
+// ограничением на число раскрытых позиций
+//
+// Повторение позиции на пути поиска (и возврат к позициям партии, переданным в solve) считается
+// неудачей атакующей стороны, поэтому доказанный выигрыш не опирается на повторения. Остальные правила
+// ничьей партии (предел числа ходов, ходы только дамками) учитываются ограничением длины выигрыша
+// max_plies: позиция на этой глубине, в которой у защищающейся стороны еще есть ходы, - неудача
+// атакующего. Доказательство зависит от оставшегося числа полуходов, поэтому оно входит в ключ таблицы
+//
+// Ходы строятся в арене решателя, доски потомков - в буферах по уровням, поэтому раскрытие
+// позиции не обращается к куче
+//
+// Режим "solve" решает позиции из файла или стандартного ввода (задачи, окончания)
+// Параметр Rules - вариант правил (см. Rules.h)
+template <class Rules> class BasicSolver
+{
+  public:
+    typedef BasicZobrist<Rules> Zobrist;
+
+    // Параметр size_mb - размер таблицы чисел доказательства в мегабайтах
+    explicit BasicSolver(const size_t size_mb = 16)
+        : config(json{{"Bot", {{"NoRandom", true}, {"BotScoringType", "Number"}, {"Optimization", "O1"}}}}),
+          logic(nullptr, &config), boards(MAX_PLY + 1, vector<vector<POS_T>>(Rules::SIZE, vector<POS_T>(Rules::SIZE, 0)))
+    {
+        resize(size_mb);
+    }
+
+    // Изменение размера таблицы с очисткой
+    void resize(const size_t size_mb)
+    {
+        size_t count = 2;
+        while (count * 2 * sizeof(Entry) <= size_mb * 1024 * 1024)
+            count *= 2;
+        table.assign(count, Entry());
+    }
+
+    // Запуск режима "solve" (только для русских шашек: позиции записываются в FEN русских шашек)
+    // Параметры командной строки:
+    // --nodes N - ограничение на число раскрытых позиций для каждой позиции (по умолчанию 1000000)
+    // --hash MB - размер таблицы (по умолчанию 64)
+    // --plies N - засчитываются только выигрыши не длиннее N полуходов (по умолчанию без ограничения)
+    // файл - входной файл (по умолчанию или "-" - стандартный ввод), строки "<FEN|startpos> [moves <ход> ...]"
+    // Для каждой позиции выводится строка JSON: итог ("won", "lost", "unknown" для ходящего),
+    // выигрывающий ход, размер дерева доказательства и число раскрытых позиций
+    // Возвращает 0 при успехе, 1 при ошибке в параметрах
+    int run(const int argc, char *argv[])
+    {
+        uint64_t max_nodes = 1000000;
+        size_t hash_mb = 64;
+        int max_plies = 0;
+        string input = "-";
+        for (int i = 0; i < argc; ++i)
+        {
+            string arg = argv[i];
+            if (i + 1 < argc && (arg == "--nodes" || arg == "--hash" || arg == "--plies"))
+            {
+                const string value = argv[++i];
+                bool valid;
+                if (arg == "--nodes")
+                    valid = Options::parse_number(value, max_nodes, uint64_t(1), numeric_limits<uint64_t>::max());
+                else if (arg == "--hash")
+                    valid = Options::parse_number(value, hash_mb, size_t(1), size_t(65536));
+                else
+                    valid = Options::parse_number(value, max_plies, 0, 100000);
+                if (!valid)
+                {
+                    cerr << "solve: bad value '" << value << "' of " << arg << endl;
+                    return 1;
+                }
+            }
+            else if (arg.size() > 1 && arg[0] == '-')
+            {
+                cerr << "solve: unknown option " << arg << endl;
+                return 1;
+            }
+            else
+                input = arg;
+        }
+        resize(hash_mb);
+        ifstream fin;
+        if (input != "-")
+        {
+            fin.open(input);
+            if (!fin)
+            {
+                cerr << "solve: can't open " << input << endl;
+                return 1;
+            }
+        }
+        istream &in = input != "-" ? fin : cin;
+        string line;
+        while (getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            cout << solve_line(line, max_nodes, max_plies) << endl;
+        }
+        return 0;
+    }
+
+    // Доказательство позиции mtx с ходом игрока color (true - черные, false - белые)
+    // Сначала доказывается выигрыш ходящего (половина max_nodes), затем - его проигрыш
+    // (оставшиеся позиции). Таблица сохраняется между вызовами: доказанные позиции
+    // не зависят от пути к ним, поэтому повторный вызов для следующей позиции партии дешевле
+    // Параметры:
+    // max_plies - выигрыш засчитывается, только если проигравшая сторона остается без ходов не позже,
+    //   чем через столько полуходов (0 - без ограничения), например до ничьей по правилам партии
+    // history - позиции после полных ходов партии, заканчивающиеся mtx (может быть пустой):
+    //   возврат к позициям после последнего необратимого хода - неудача атакующего
+    // Поиск прерывается (результат - UNKNOWN, если ничего не доказано), когда выставлен флаг stop_flag
+    proof_info solve(const vector<vector<POS_T>> &mtx, const bool color, const uint64_t max_nodes,
+                     const int max_plies = 0, const vector<vector<vector<POS_T>>> &history = {})
+    {
+        proof_info info;
+        nodes = 0;
+        this->max_plies = max_plies;
+        const uint64_t hash = Zobrist::hash(mtx, color);
+        game_hashes.clear();
+        for (size_t i = history.size(); i-- > 1;)
+        {
+            if (!BasicLogic<Rules>::is_reversible(history[i - 1], history[i]))
+                break;
+            game_hashes.push_back(Zobrist::hash(history[i - 1], color ^ ((history.size() - i) % 2 == 1)));
+        }
+        Arena::Scope scope(arena);
+        arena.reset();
+
+        node_limit = max_nodes / 2;
+        Numbers win = prove(mtx, color, hash, color);
+        if (win.phi == 0)
+        {
+            info.result = Proof::WON;
+            info.proof_size = win.size;
+            info.best = winning_move(mtx, color, hash);
+        }
+        else
+        {
+            node_limit = max_nodes;
+            const Numbers loss = prove(mtx, color, hash, !color);
+            // В корне ходит защищающаяся сторона: ее неудача (delta = 0) - выигрыш соперника
+            if (loss.delta == 0)
+            {
+                info.result = Proof::LOST;
+                info.proof_size = loss.size;
+            }
+        }
+        info.nodes = nodes;
+        return info;
+    }
+
+    // Очистка таблицы чисел доказательства
+    void clear()
+    {
+        fill(table.begin(), table.end(), Entry());
+    }
+
+    // Флаг остановки решения из другого потока (nullptr - решение не прерывается)
+    const atomic<bool> *stop_flag = nullptr;
+
+  private:
+    // Решение позиции из строки ввода режима "solve", результат - строка JSON
+    string solve_line(const string &line, const uint64_t max_nodes, const int max_plies)
+    {
+        nlohmann::ordered_json res;
+        try
+        {
+            const game_position pos = Notation::parse_position(logic, line);
+            res["fen"] = Notation::to_fen(pos);
+            const auto start = chrono::steady_clock::now();
+            const proof_info info = solve(pos.mtx, pos.color, max_nodes, max_plies);
+            const auto end = chrono::steady_clock::now();
+            res["result"] = info.result == Proof::WON ? "won" : info.result == Proof::LOST ? "lost" : "unknown";
+            if (!info.best.empty())
+                res["best"] = Notation::move_to_string(info.best);
+            res["proof_size"] = info.proof_size;
+            res["nodes"] = info.nodes;
+            res["time_ms"] = int64_t(chrono::duration<double, milli>(end - start).count());
+        }
+        catch (const exception &e)
+        {
+            res["input"] = line;
+            res["error"] = e.what();
+        }
+        return res.dump();
+    }
+
+    // Числа доказательства и опровержения позиции с точки зрения ходящего и размер дерева решения
+    struct Numbers
+    {
+        uint32_t phi = 1;
+        uint32_t delta = 1;
+        uint64_t size = 1;
+    };
+
+    // Запись таблицы: числа позиции и работа (число раскрытий), затраченная на нее
+    struct Entry
+    {
+        uint64_t key = 0;
+        uint32_t phi = 0;
+        uint32_t delta = 0;
+        uint64_t size = 0;
+        uint64_t work = 0;
+    };
+
+    typedef typename BasicLogic<Rules>::search_chains Chains;
+
+    // "Бесконечное" число доказательства: позиция решена
+    static constexpr uint32_t INF_PN = 1u << 30;
+
+    // Наибольшая длина пути поиска, дальше позиция считается неудачей атакующего
+    static constexpr int MAX_PLY = 256;
+
+    // Добавка к ключу для поиска выигрыша черных: записи двух направлений доказательства не смешиваются
+    static constexpr uint64_t BLACK_ATTACKER = 0xD6E8FEB86659FD93ull;
+
+    // Множитель оставшегося числа полуходов в ключе (при ограничении max_plies)
+    static constexpr uint64_t REMAINING_KEY = 0x9E3779B97F4A7C15ull;
+
+    static uint32_t add(const uint32_t a, const uint32_t b)
+    {
+        return min(INF_PN, a + b);
+    }
+
+    // Доказательство выигрыша стороны attacker из позиции mtx с ходом color
+    Numbers prove(const vector<vector<POS_T>> &mtx, const bool color, const uint64_t hash, const bool attacker)
+    {
+        this->attacker = attacker;
+        path = game_hashes;
+        mid(mtx, color, hash, 0, INF_PN, INF_PN);
+        return lookup(hash, color, 0);
+    }
+
+    // Числа позиции на глубине ply, в которой ходит color, если ее нет на пути поиска и в таблице - (1, 1)
+    // Повторение позиции пути - неудача атакующего
+    Numbers lookup(const uint64_t hash, const bool color, const int ply) const
+    {
+        Numbers n;
+        if (find(path.begin(), path.end(), hash) != path.end())
+            return failure(color);
+        if (const Entry *e = probe(hash, ply))
+        {
+            n.phi = e->phi;
+            n.delta = e->delta;
+            n.size = e->size;
+        }
+        return n;
+    }
+
+    // Числа позиции, где атакующий уже не может выиграть, с точки зрения ходящего color
+    Numbers failure(const bool color) const
+    {
+        Numbers n;
+        n.phi = color == attacker ? INF_PN : 0;
+        n.delta = color == attacker ? 0 : INF_PN;
+        return n;
+    }
+
+    bool stopped() const
+    {
+        return stop_flag && stop_flag->load(memory_order_relaxed);
+    }
+
+    // Раскрытие позиции mtx на глубине ply с ходом color, пока ее числа не превысят пороги th_phi, th_delta
+    // или не исчерпано число позиций
+    void mid(const vector<vector<POS_T>> &mtx, const bool color, const uint64_t hash, const int ply,
+             const uint32_t th_phi, const uint32_t th_delta)
+    {
+        const uint64_t work_start = nodes++;
+        Arena::Rewind rewind;
+        Chains chains;
+        logic.find_chains(color, mtx, chains);
+        // Нет ходов - ходящий проиграл
+        if (chains.empty())
+        {
+            store(hash, ply, Numbers{INF_PN, 0, 1}, 1);
+            return;
+        }
+        if (ply >= MAX_PLY || (max_plies && ply >= max_plies))
+        {
+            store(hash, ply, failure(color), 1);
+            return;
+        }
+        // Хеши потомков; доска потомка строится заново перед каждым его раскрытием
+        auto &child = boards[ply + 1];
+        arena_vector<uint64_t> hashes;
+        hashes.reserve(chains.size());
+        for (const auto &chain : chains)
+        {
+            child = mtx;
+            logic.apply_chain(child, chain);
+            hashes.push_back(Zobrist::update(hash, mtx, child, chain));
+        }
+
+        path.push_back(hash);
+        Numbers n;
+        while (true)
+        {
+            // phi узла - наименьшее delta потомка, delta узла - сумма phi потомков
+            n.phi = INF_PN;
+            n.delta = 0;
+            size_t best = 0;
+            uint32_t second = INF_PN, best_phi = 0;
+            for (size_t i = 0; i < hashes.size(); ++i)
+            {
+                const Numbers c = lookup(hashes[i], !color, ply + 1);
+                n.delta = add(n.delta, c.phi);
+                if (c.delta < n.phi)
+                {
+                    second = n.phi;
+                    n.phi = c.delta;
+                    best = i;
+                    best_phi = c.phi;
+                }
+                else if (c.delta < second)
+                    second = c.delta;
+            }
+            if (n.phi >= th_phi || n.delta >= th_delta || nodes >= node_limit || stopped())
+                break;
+            // Пороги потомка: он раскрывается, пока остается самым дешевым и delta родителя не превышена
+            child = mtx;
+            logic.apply_chain(child, chains[best]);
+            mid(child, !color, hashes[best], ply + 1, add(th_delta - n.delta, best_phi),
+                min(th_phi, add(second, 1)));
+        }
+        path.pop_back();
+        n.size = solution_size(hashes, color, ply, n);
+        store(hash, ply, n, nodes - work_start);
+    }
+
+    // Размер дерева решения решенной позиции на глубине ply: для успеха ходящего - самый короткий
+    // успешный ход, для неудачи - все ходы. Для нерешенной позиции - 1
+    uint64_t solution_size(const arena_vector<uint64_t> &hashes, const bool color, const int ply,
+                           const Numbers &n) const
+    {
+        if (n.phi != 0 && n.delta != 0)
+            return 1;
+        uint64_t size = n.phi == 0 ? UINT64_MAX : 0;
+        for (const uint64_t hash : hashes)
+        {
+            const Numbers c = lookup(hash, !color, ply + 1);
+            if (n.phi == 0 && c.delta == 0)
+                size = min(size, c.size);
+            else if (n.delta == 0)
+                size += c.size;
+        }
+        return size == UINT64_MAX ? 1 : size + 1;
+    }
+
+    // Ход, ведущий к доказанному выигрышу, с наименьшим деревом доказательства
+    vector<move_pos> winning_move(const vector<vector<POS_T>> &mtx, const bool color, const uint64_t hash)
+    {
+        attacker = color;
+        path = game_hashes;
+        path.push_back(hash);
+        Arena::Rewind rewind;
+        Chains chains;
+        logic.find_chains(color, mtx, chains);
+        auto &child = boards[1];
+        size_t best = chains.size();
+        uint64_t best_size = UINT64_MAX;
+        for (size_t i = 0; i < chains.size(); ++i)
+        {
+            child = mtx;
+            logic.apply_chain(child, chains[i]);
+            const Numbers c = lookup(Zobrist::update(hash, mtx, child, chains[i]), !color, 1);
+            if (c.delta == 0 && c.size < best_size)
+            {
+                best = i;
+                best_size = c.size;
+            }
+        }
+        path.clear();
+        if (best == chains.size())
+            return {};
+        return vector<move_pos>(chains[best].path.begin(), chains[best].path.end());
+    }
+
+    // Ключ таблицы для позиции на глубине ply: при ограничении длины выигрыша в ключ входит
+    // оставшееся число полуходов
+    uint64_t key(const uint64_t hash, const int ply) const
+    {
+        const uint64_t k = attacker ? hash ^ BLACK_ATTACKER : hash;
+        return max_plies ? k ^ (uint64_t(max_plies - ply + 1) * REMAINING_KEY) : k;
+    }
+
+    const Entry *probe(const uint64_t hash, const int ply) const
+    {
+        const uint64_t k = key(hash, ply);
+        const size_t index = k & (table.size() - 2);
+        for (size_t i = index; i < index + 2; ++i)
+        {
+            if (table[i].key == k && table[i].work)
+                return &table[i];
+        }
+        return nullptr;
+    }
+
+    // Сохранение чисел позиции: в корзине заменяется запись этой позиции или запись с меньшей работой
+    void store(const uint64_t hash, const int ply, const Numbers &n, const uint64_t work)
+    {
+        const uint64_t k = key(hash, ply);
+        const size_t index = k & (table.size() - 2);
+        Entry *slot = &table[index];
+        if (table[index].key != k && (table[index + 1].key == k || table[index + 1].work < table[index].work))
+            slot = &table[index + 1];
+        if (slot->key == k)
+            slot->work += work;
+        else
+            slot->work = work;
+        slot->key = k;
+        slot->phi = n.phi;
+        slot->delta = n.delta;
+        slot->size = n.size;
+    }
+
+    Config config;
+    BasicLogic<Rules> logic;           // Генератор ходов
+    Arena arena;                       // Списки ходов и хеши потомков на пути поиска
+    vector<vector<vector<POS_T>>> boards;  // Доски потомков по уровням (индекс - глубина потомка)
+    vector<Entry> table;               // Таблица чисел доказательства (корзины по две записи)
+    vector<uint64_t> path;             // Хеши позиций партии и пути от корня
+    vector<uint64_t> game_hashes;      // Хеши позиций партии, к которым нельзя вернуться (см. solve)
+    bool attacker = false;             // Сторона, выигрыш которой доказывается
+    int max_plies = 0;                 // Ограничение длины выигрыша в полуходах (0 - без ограничения)
+    uint64_t nodes = 0;                // Число раскрытых позиций текущего вызова solve
+    uint64_t node_limit = 0;           // Ограничение на число раскрытых позиций
+};
+
+typedef BasicSolver<RussianRules> Solver;
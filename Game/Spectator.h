@@ -0,0 +1,453 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "Board.h"
+#include "Logic.h"
+#include "Options.h"
+#include "Textures.h"
+
+// Просмотр многих партий бота с самим собой в одном окне (режим "watch")
+// Все партии идут одновременно, каждая в своем потоке (ход ищут не больше --threads партий сразу),
+// а главный поток рисует их доски сеткой. Доски рисуются
+// на холст (текстуру-цель) и перерисовываются только после хода в своей партии; кадр - копия
+// холста в окно, и если ни одна партия не изменилась, кадр не выводится
+// Все изменившиеся доски кадра рисуются пакетами из атласа текстур: доски, затем шашки, затем
+// картинки итогов - по одному вызову SDL_RenderGeometry на страницу атласа, поэтому число вызовов
+// рисования не зависит от числа партий
+// Если рендерер не поддерживает текстуры-цели, каждый кадр с изменениями рисует все доски прямо в окно
+class Spectator
+{
+  public:
+    // Запуск просмотра
+    // Параметры командной строки:
+    // --games N - число партий, все идут одновременно (по умолчанию 16, не больше 1024)
+    // --threads N - число партий, одновременно ищущих ход (по умолчанию на один меньше числа ядер)
+    // --depth D - глубина поиска (по умолчанию 4)
+    // --movetime MS - ограничение времени поиска на ход (по умолчанию без ограничения)
+    // --delay MS - пауза после каждого хода, чтобы за партиями можно было следить (по умолчанию 250)
+    // --random-plies K - число случайных ходов в начале партии (по умолчанию 4)
+    // --max-plies M - предел числа ходов (полуходов) партии, после него ничья (по умолчанию 120)
+    // --fps F - частота кадров (по умолчанию 60)
+    // --seed S - начальное значение генератора случайных ходов (по умолчанию 1)
+    // --opt O - уровень оптимизации поиска (по умолчанию O2)
+    // --scoring S - режим оценки позиции (по умолчанию NumberAndPotential)
+    // Окно закрывается крестиком, незаконченные партии прерываются
+    // Выводит число кадров и время их рисования. Возвращает 0 при успехе, 1 при ошибке
+    int run(const int argc, char *argv[])
+    {
+        size_t count = 16, threads = 0;
+        string optimization = "O2", scoring = "NumberAndPotential";
+        for (int i = 0; i + 1 < argc; i += 2)
+        {
+            string arg = argv[i], value = argv[i + 1];
+            bool valid = true;
+            if (arg == "--games")
+                valid = Options::parse_number(value, count, size_t(1), size_t(1024));
+            else if (arg == "--threads")
+                valid = Options::parse_number(value, threads, size_t(0), size_t(1024));
+            else if (arg == "--depth")
+                valid = Options::parse_number(value, limits.depth, 1, 64);
+            else if (arg == "--movetime")
+                valid = Options::parse_number(value, limits.time_ms, int64_t(0), int64_t(3600000));
+            else if (arg == "--delay")
+                valid = Options::parse_number(value, delay_ms, 0, 60000);
+            else if (arg == "--random-plies")
+                valid = Options::parse_number(value, random_plies, 0, 1000);
+            else if (arg == "--max-plies")
+                valid = Options::parse_number(value, max_plies, 1, 10000);
+            else if (arg == "--fps")
+                valid = Options::parse_number(value, fps, 1, 1000);
+            else if (arg == "--seed")
+                valid = Options::parse_number(value, seed, uint64_t(0), numeric_limits<uint64_t>::max());
+            else if (arg == "--opt")
+                optimization = value;
+            else if (arg == "--scoring")
+                scoring = value;
+            else
+            {
+                cerr << "watch: unknown option " << arg << endl;
+                return 1;
+            }
+            if (!valid)
+            {
+                cerr << "watch: bad value '" << value << "' of " << arg << endl;
+                return 1;
+            }
+        }
+        if (argc % 2)
+        {
+            cerr << "watch: missing value for " << argv[argc - 1] << endl;
+            return 1;
+        }
+        if (threads == 0)
+            threads = max(2u, thread::hardware_concurrency()) - 1;  // hardware_concurrency может вернуть 0
+        free_slots = threads;
+
+        config = Config(json{{"Bot", {{"NoRandom", true}, {"BotScoringType", scoring}, {"Optimization", optimization}}}});
+        try
+        {
+            // Ошибка в настройках бота сообщается здесь, а не исключением в потоке партии
+            Logic check(nullptr, &config);
+        }
+        catch (const exception &e)
+        {
+            cerr << "watch: " << e.what() << endl;
+            return 1;
+        }
+        games = vector<LiveGame>(count);
+        for (auto &game : games)
+            game.mtx = Board::start_mtx();
+        if (!open_window())
+        {
+            close_window();
+            return 1;
+        }
+
+        {
+            // Все партии идут одновременно, каждая в своем потоке
+            vector<thread> players;
+            for (size_t id = 0; id < count; ++id)
+                players.emplace_back([this, id] { play_game(id); });
+            show();
+            {
+                lock_guard<mutex> lock(slots_mtx);
+                stop = true;  // Прерывание незаконченных партий
+            }
+            slot_freed.notify_all();
+            for (auto &player : players)
+                player.join();
+        }
+        close_window();
+
+        cout << "Games     : " << finished << "/" << count << " finished\n";
+        cout << "Frames    : " << frames << "\n";
+        cout << "Frame (ms): mean " << (frames ? frame_total_ms / frames : 0.0) << ", max " << frame_max_ms
+             << ", over " << 1000.0 / fps << " ms budget " << frames_late << endl;
+        return 0;
+    }
+
+  private:
+    // Партия, которую показывает окно: поток партии обновляет позицию, главный поток рисует
+    struct LiveGame
+    {
+        mutex lock;
+        vector<vector<POS_T>> mtx;  // Текущая позиция
+        int result = -1;            // Итог как в Board::show_final (-1 - партия идет)
+        uint64_t version = 0;       // Номер изменения позиции или итога
+    };
+
+    // Одна партия бота с самим собой (позиции публикуются в games[id])
+    void play_game(const size_t id)
+    {
+        Logic logic(nullptr, &config);
+        logic.stop_flag = &stop;
+        mt19937_64 rng(seed * 1000003 + id);
+        game_position pos{Board::start_mtx(), false};
+        vector<vector<vector<POS_T>>> history(1, pos.mtx);
+        int result = 0;
+        for (int ply = 0; ply < max_plies && !Logic::is_draw_by_rules(history, 3, 15); ++ply)
+        {
+            if (stop)
+                return;
+            const auto chains = logic.find_chains(pos.color, pos.mtx);
+            if (chains.empty())
+            {
+                result = pos.color ? 1 : 2;
+                break;
+            }
+            vector<move_pos> best;
+            if (ply < random_plies)
+                best = chains[uniform_int_distribution<size_t>(0, chains.size() - 1)(rng)].path;
+            else
+            {
+                // Одновременно ищут ход не больше --threads партий, остальные ждут своей очереди
+                {
+                    unique_lock<mutex> lock(slots_mtx);
+                    slot_freed.wait(lock, [this] { return free_slots > 0 || stop; });
+                    if (stop)
+                        return;
+                    --free_slots;
+                }
+                best = logic.search(pos.mtx, pos.color, history, limits).best;
+                {
+                    lock_guard<mutex> lock(slots_mtx);
+                    ++free_slots;
+                }
+                slot_freed.notify_one();
+            }
+            if (best.empty())  // Поиск прерван закрытием окна
+                return;
+            for (const auto &turn : best)
+                pos.mtx = logic.make_turn(pos.mtx, turn);
+            pos.color = !pos.color;
+            history.push_back(pos.mtx);
+            publish(id, pos.mtx, -1);
+            if (delay_ms > 0)
+                this_thread::sleep_for(chrono::milliseconds(delay_ms));
+        }
+        publish(id, pos.mtx, result);
+        ++finished;
+    }
+
+    // Публикация позиции и итога партии id для окна
+    void publish(const size_t id, const vector<vector<POS_T>> &mtx, const int result)
+    {
+        LiveGame &game = games[id];
+        lock_guard<mutex> lock(game.lock);
+        game.mtx = mtx;
+        game.result = result;
+        ++game.version;
+    }
+
+    // Создание окна, рендерера, атласа и холста
+    // Возвращает false при ошибке (выводится в cerr)
+    bool open_window()
+    {
+        if (SDL_Init(SDL_INIT_VIDEO) != 0 || (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0)
+            return fail("can't init SDL2 video subsystem");
+        SDL_DisplayMode dm;
+        if (SDL_GetDesktopDisplayMode(0, &dm))
+            return fail("can't get desktop display mode");
+        const int side = min(dm.w, dm.h) * 14 / 15;
+        win = SDL_CreateWindow("Checkers", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, side, side,
+                               SDL_WINDOW_RESIZABLE);
+        if (win == nullptr)
+            return fail("can't create window");
+        // Кадры выводятся по своему расписанию (--fps), поэтому без ожидания вертикальной синхронизации
+        ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+        if (ren == nullptr)
+            return fail("can't create renderer");
+        if (!textures.load(ren, project_path + "Textures/"))
+            return fail("can't load textures from " + project_path + "Textures/");
+        resize();
+        return true;
+    }
+
+    bool fail(const string &text) const
+    {
+        cerr << "watch: " << text << ": " << SDL_GetError() << endl;
+        return false;
+    }
+
+    void close_window()
+    {
+        if (canvas)
+            SDL_DestroyTexture(canvas);
+        canvas = nullptr;
+        textures.clear();
+        if (ren)
+            SDL_DestroyRenderer(ren);
+        if (win)
+            SDL_DestroyWindow(win);
+        ren = nullptr;
+        win = nullptr;
+        IMG_Quit();
+        SDL_Quit();
+    }
+
+    // Раскладка досок под размер окна и новый холст; все доски будут перерисованы
+    void resize()
+    {
+        SDL_GetRendererOutputSize(ren, &W, &H);
+        cols = int(ceil(sqrt(double(games.size()))));
+        const int rows = int((games.size() + cols - 1) / cols);
+        cell = max(1, min(W / cols, H / rows));
+        left = (W - cell * cols) / 2;
+        top = (H - cell * rows) / 2;
+        if (canvas)
+            SDL_DestroyTexture(canvas);
+        canvas = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, W, H);
+        redraw_all();
+    }
+
+    // Холст потерян или пересоздан: все доски рисуются заново, начиная с фона
+    void redraw_all()
+    {
+        clear_canvas = true;
+        drawn.assign(games.size(), ~uint64_t(0));
+    }
+
+    // Цикл окна: события и кадры с частотой fps до закрытия окна
+    void show()
+    {
+        const auto interval = chrono::microseconds(1000000 / fps);
+        auto next_frame = chrono::steady_clock::now();
+        auto next_title = next_frame;
+        while (true)
+        {
+            const auto now = chrono::steady_clock::now();
+            if (now >= next_frame)
+            {
+                render_frame();
+                next_frame += interval;
+                if (next_frame < now)  // Кадр опоздал: расписание сдвигается, а не догоняет
+                    next_frame = now + interval;
+            }
+            if (now >= next_title)
+            {
+                update_title();
+                next_title = now + chrono::seconds(1);
+            }
+            const auto wait = chrono::duration_cast<chrono::milliseconds>(next_frame - chrono::steady_clock::now());
+            SDL_Event event;
+            if (!SDL_WaitEventTimeout(&event, max(1, int(wait.count()))))
+                continue;
+            do
+            {
+                if (event.type == SDL_QUIT)
+                    return;
+                if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                    resize();
+                else if (event.type == SDL_RENDER_TARGETS_RESET)
+                    redraw_all();
+                else if (event.type == SDL_RENDER_DEVICE_RESET)
+                {
+                    // Вместе с устройством потеряны все текстуры, включая атлас
+                    if (!textures.load(ren, project_path + "Textures/"))
+                    {
+                        fail("can't reload textures");
+                        return;
+                    }
+                    resize();
+                }
+            } while (SDL_PollEvent(&event));
+        }
+    }
+
+    // Кадр: изменившиеся доски рисуются на холст, холст копируется в окно
+    // Если изменений нет, кадр не выводится
+    void render_frame()
+    {
+        const auto start = chrono::steady_clock::now();
+        // Снимки изменившихся партий (блокировка партии - только на время копирования позиции)
+        vector<size_t> changed;
+        snapshots.resize(games.size());
+        for (size_t id = 0; id < games.size(); ++id)
+        {
+            lock_guard<mutex> lock(games[id].lock);
+            if (games[id].version == drawn[id])
+                continue;
+            snapshots[id].mtx = games[id].mtx;
+            snapshots[id].result = games[id].result;
+            drawn[id] = games[id].version;
+            changed.push_back(id);
+        }
+        if (changed.empty() && !clear_canvas)
+            return;
+        if (canvas == nullptr)
+        {
+            // Без холста окно рисуется целиком, но только когда что-то изменилось
+            changed.clear();
+            for (size_t id = 0; id < games.size(); ++id)
+                changed.push_back(id);
+        }
+
+        SDL_SetRenderTarget(ren, canvas);
+        if (clear_canvas || canvas == nullptr)
+        {
+            SDL_SetRenderDrawColor(ren, 40, 40, 40, 255);
+            SDL_RenderClear(ren);
+            clear_canvas = false;
+        }
+        for (const size_t id : changed)
+            textures.queue("board", cell_rect(id, 0, 0, float(cell), float(cell)));
+        textures.flush(ren);
+        for (const size_t id : changed)
+        {
+            const auto &mtx = snapshots[id].mtx;
+            for (POS_T i = 0; i < Board::Rules::SIZE; ++i)
+            {
+                for (POS_T j = 0; j < Board::Rules::SIZE; ++j)
+                {
+                    if (!mtx[i][j])
+                        continue;
+                    // Шашка занимает 5/6 клетки и стоит в ее центре, как в Board
+                    const float step = float(cell) / Board::CELLS;
+                    textures.queue(piece_names[mtx[i][j] - 1],
+                                   cell_rect(id, step * (j + 1) + step / 12, step * (i + 1) + step / 12,
+                                             step * 5 / 6, step * 5 / 6));
+                }
+            }
+        }
+        textures.flush(ren);
+        for (const size_t id : changed)
+        {
+            const int result = snapshots[id].result;
+            if (result != -1)
+                textures.queue(result == 1 ? "white_wins" : result == 2 ? "black_wins" : "draw",
+                               cell_rect(id, cell / 5.f, cell * 3 / 10.f, cell * 3 / 5.f, cell * 2 / 5.f));
+        }
+        textures.flush(ren);
+        if (canvas)
+        {
+            SDL_SetRenderTarget(ren, nullptr);
+            SDL_RenderCopy(ren, canvas, nullptr, nullptr);
+        }
+        SDL_RenderPresent(ren);
+
+        const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        ++frames;
+        frame_total_ms += ms;
+        frame_max_ms = max(frame_max_ms, ms);
+        if (ms > 1000.0 / fps)
+            ++frames_late;
+    }
+
+    // Прямоугольник (x, y, w, h) внутри клетки сетки доски id
+    SDL_FRect cell_rect(const size_t id, const float x, const float y, const float w, const float h) const
+    {
+        return SDL_FRect{float(left + int(id % cols) * cell) + x, float(top + int(id / cols) * cell) + y, w, h};
+    }
+
+    // Заголовок окна: число законченных партий и время кадров
+    void update_title()
+    {
+        const string title = "Checkers: " + to_string(finished.load()) + "/" + to_string(games.size()) +
+                             " games finished, frame max " + to_string(int(ceil(frame_max_ms))) + " ms";
+        SDL_SetWindowTitle(win, title.c_str());
+    }
+
+    // Позиция и итог партии, нарисованные на холсте
+    struct Snapshot
+    {
+        vector<vector<POS_T>> mtx;
+        int result = -1;
+    };
+
+    Config config{json::object()};  // Настройки бота
+    search_limits limits{4, 0, 0};  // Ограничения поиска на ход
+    int delay_ms = 250;             // Пауза после хода
+    int random_plies = 4;           // Число случайных ходов в начале партии
+    int max_plies = 120;            // Предел числа ходов партии
+    int fps = 60;                   // Частота кадров
+    uint64_t seed = 1;              // Начальное значение генератора случайных ходов
+    vector<LiveGame> games;         // Партии
+    atomic<bool> stop{false};       // Окно закрыто: партии прерываются
+    atomic<size_t> finished{0};     // Число законченных партий
+    size_t free_slots = 0;          // Число партий, которые еще могут начать поиск хода (см. --threads)
+    mutex slots_mtx;
+    condition_variable slot_freed;
+
+    SDL_Window *win = nullptr;
+    SDL_Renderer *ren = nullptr;
+    SDL_Texture *canvas = nullptr;  // Холст с досками (nullptr - рендерер не поддерживает текстуры-цели)
+    TextureAtlas textures;
+    // Текстуры шашек по коду клетки 1-4
+    const vector<string> piece_names = {"piece_white", "piece_black", "queen_white", "queen_black"};
+    int W = 0, H = 0;                     // Размер окна
+    int cols = 1, cell = 1;               // Число досок в строке сетки и сторона доски
+    int left = 0, top = 0;                // Отступ сетки от края окна
+    vector<uint64_t> drawn;               // Номер изменения каждой партии, нарисованного на холсте
+    vector<Snapshot> snapshots;           // Позиции партий для рисования
+    bool clear_canvas = true;             // Холст нужно залить фоном перед рисованием досок
+    uint64_t frames = 0;                  // Число выведенных кадров
+    uint64_t frames_late = 0;             // Число кадров, нарисованных дольше интервала кадра
+    double frame_total_ms = 0, frame_max_ms = 0;
+};
@@ -0,0 +1,258 @@
+#pragma once
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+// Условная компиляция для разных операционных систем
+#ifdef __APPLE__
+    #include <SDL2/SDL.h>
+    #include <SDL2/SDL_image.h>
+#else
+    #include <SDL.h>
+    #include <SDL_image.h>
+#endif
+
+// Атлас текстур: все изображения PNG из папки загружаются один раз при запуске, упаковываются
+// полками в несколько больших страниц (не больше максимального размера текстуры рендерера)
+// и хранятся до выхода из игры. Изображение рисуется по имени файла без расширения
+// ("board", "white_wins") копированием своего прямоугольника страницы
+// Страницы собираются в памяти и загружаются на видеокарту целиком, поэтому не теряются
+// при сбросе устройства рендерера, в отличие от текстур-целей отрисовки
+// Много изображений можно нарисовать пакетом: queue накапливает прямоугольники, flush рисует
+// их одним вызовом SDL_RenderGeometry на страницу (нужен SDL 2.0.18 или новее)
+class TextureAtlas
+{
+  public:
+    TextureAtlas() = default;
+    TextureAtlas(const TextureAtlas &) = delete;
+    TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+    ~TextureAtlas()
+    {
+        clear();
+    }
+
+    // Загрузка всех файлов *.png из папки dir (прежнее содержимое атласа удаляется)
+    // Возвращает false при ошибке, описание ошибки - в SDL_GetError
+    bool load(SDL_Renderer *ren, const std::string &dir)
+    {
+        clear();
+        std::vector<Image> images;
+        std::error_code ec;
+        for (const auto &file : std::filesystem::directory_iterator(dir, ec))
+        {
+            if (file.path().extension() != ".png")
+                continue;
+            SDL_Surface *surface = IMG_Load(file.path().string().c_str());
+            if (surface == nullptr)
+            {
+                free_images(images);
+                return false;
+            }
+            images.push_back({file.path().stem().string(), surface, 0, SDL_Rect{0, 0, surface->w, surface->h}});
+        }
+        if (ec || images.empty())
+        {
+            free_images(images);
+            SDL_SetError("no textures in %s", dir.c_str());
+            return false;
+        }
+
+        // Упаковка полками: изображения по убыванию высоты слева направо, полка заканчивается
+        // на краю страницы, страница - когда следующая полка не помещается по высоте
+        std::sort(images.begin(), images.end(), [](const Image &a, const Image &b) {
+            return a.rect.h != b.rect.h ? a.rect.h > b.rect.h : a.name < b.name;
+        });
+        const int limit = page_limit(ren);
+        std::vector<SDL_Rect> extents;  // Занятый размер каждой страницы
+        int x = 0, y = 0, shelf = 0;
+        for (Image &image : images)
+        {
+            const int w = image.rect.w + PADDING, h = image.rect.h + PADDING;
+            if (!extents.empty() && x + w > limit)
+            {
+                x = 0;
+                y += shelf;
+                shelf = 0;
+            }
+            if (extents.empty() || y + h > limit)
+            {
+                extents.push_back(SDL_Rect{0, 0, 0, 0});
+                x = y = shelf = 0;
+            }
+            image.page = extents.size() - 1;
+            image.rect.x = x;
+            image.rect.y = y;
+            x += w;
+            shelf = std::max(shelf, h);
+            extents.back().w = std::max(extents.back().w, image.rect.x + image.rect.w);
+            extents.back().h = std::max(extents.back().h, image.rect.y + image.rect.h);
+        }
+
+        // Сборка страниц в памяти и загрузка на видеокарту
+        for (size_t page = 0; page < extents.size(); ++page)
+        {
+            SDL_Surface *canvas =
+                SDL_CreateRGBSurfaceWithFormat(0, extents[page].w, extents[page].h, 32, SDL_PIXELFORMAT_RGBA32);
+            bool ok = canvas != nullptr;
+            for (Image &image : images)
+            {
+                if (!ok || image.page != page)
+                    continue;
+                // Копирование без смешивания: прозрачность переносится в атлас как есть
+                SDL_SetSurfaceBlendMode(image.surface, SDL_BLENDMODE_NONE);
+                ok = SDL_BlitSurface(image.surface, nullptr, canvas, &image.rect) == 0;
+            }
+            SDL_Texture *texture = ok ? SDL_CreateTextureFromSurface(ren, canvas) : nullptr;
+            if (canvas)
+                SDL_FreeSurface(canvas);
+            if (texture == nullptr)
+            {
+                free_images(images);
+                clear();
+                return false;
+            }
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+            pages.push_back(texture);
+            page_sizes.push_back(SDL_Point{extents[page].w, extents[page].h});
+        }
+        for (const Image &image : images)
+            sprites[image.name] = Sprite{pages[image.page], image.page, image.rect};
+        free_images(images);
+        return true;
+    }
+
+    // Есть ли в атласе изображение name
+    bool has(const std::string &name) const
+    {
+        return sprites.count(name) != 0;
+    }
+
+    // Рисование изображения name в прямоугольник dst (nullptr - все окно)
+    // Возвращает 0 при успехе, -1 если изображения нет или копирование не удалось
+    int draw(SDL_Renderer *ren, const std::string &name, const SDL_Rect *dst) const
+    {
+        const auto it = sprites.find(name);
+        if (it == sprites.end())
+            return -1;
+        return SDL_RenderCopy(ren, it->second.page, &it->second.src, dst);
+    }
+
+    // Добавление изображения name в пакет для рисования в прямоугольник dst
+    // Возвращает false, если изображения нет
+    bool queue(const std::string &name, const SDL_FRect &dst)
+    {
+        const auto it = sprites.find(name);
+        if (it == sprites.end())
+            return false;
+        const Sprite &sprite = it->second;
+        if (batches.size() < pages.size())
+            batches.resize(pages.size());
+        const SDL_Point size = page_sizes[sprite.index];
+        const float u0 = float(sprite.src.x) / size.x, u1 = float(sprite.src.x + sprite.src.w) / size.x;
+        const float v0 = float(sprite.src.y) / size.y, v1 = float(sprite.src.y + sprite.src.h) / size.y;
+        const SDL_Color white{255, 255, 255, 255};
+        auto &vertices = batches[sprite.index];
+        vertices.push_back(SDL_Vertex{SDL_FPoint{dst.x, dst.y}, white, SDL_FPoint{u0, v0}});
+        vertices.push_back(SDL_Vertex{SDL_FPoint{dst.x + dst.w, dst.y}, white, SDL_FPoint{u1, v0}});
+        vertices.push_back(SDL_Vertex{SDL_FPoint{dst.x, dst.y + dst.h}, white, SDL_FPoint{u0, v1}});
+        vertices.push_back(SDL_Vertex{SDL_FPoint{dst.x + dst.w, dst.y + dst.h}, white, SDL_FPoint{u1, v1}});
+        return true;
+    }
+
+    // Рисование накопленного пакета: один вызов SDL_RenderGeometry на каждую страницу с изображениями
+    // Возвращает число вызовов рисования
+    int flush(SDL_Renderer *ren)
+    {
+        int calls = 0;
+        for (size_t page = 0; page < batches.size(); ++page)
+        {
+            auto &vertices = batches[page];
+            if (vertices.empty())
+                continue;
+            // Два треугольника на прямоугольник, индексы общие для всех пакетов
+            while (indices.size() / 6 < vertices.size() / 4)
+            {
+                const int base = int(indices.size() / 6 * 4);
+                for (const int k : {0, 1, 2, 2, 1, 3})
+                    indices.push_back(base + k);
+            }
+            SDL_RenderGeometry(ren, pages[page], vertices.data(), int(vertices.size()), indices.data(),
+                               int(vertices.size() / 4 * 6));
+            vertices.clear();
+            ++calls;
+        }
+        return calls;
+    }
+
+    // Число страниц атласа
+    size_t pages_count() const
+    {
+        return pages.size();
+    }
+
+    // Удаление всех текстур атласа
+    void clear()
+    {
+        for (SDL_Texture *page : pages)
+            SDL_DestroyTexture(page);
+        pages.clear();
+        page_sizes.clear();
+        batches.clear();
+        sprites.clear();
+    }
+
+  private:
+    // Изображение в атласе: страница и прямоугольник на ней
+    struct Sprite
+    {
+        SDL_Texture *page = nullptr;
+        size_t index = 0;  // Номер страницы
+        SDL_Rect src{0, 0, 0, 0};
+    };
+
+    // Загруженное изображение при упаковке
+    struct Image
+    {
+        std::string name;
+        SDL_Surface *surface = nullptr;
+        size_t page = 0;
+        SDL_Rect rect{0, 0, 0, 0};
+    };
+
+    // Промежуток между изображениями, чтобы при масштабировании соседние изображения не просвечивали на краях
+    static const int PADDING = 2;
+    // Наибольшая сторона страницы, если рендерер не ограничивает размер текстур
+    static const int MAX_PAGE = 4096;
+
+    // Наибольшая сторона страницы для рендерера ren
+    // Изображение больше страницы занимает отдельную страницу своего размера
+    static int page_limit(SDL_Renderer *ren)
+    {
+        SDL_RendererInfo info;
+        int limit = MAX_PAGE;
+        if (SDL_GetRendererInfo(ren, &info) == 0)
+        {
+            if (info.max_texture_width > 0)
+                limit = std::min(limit, info.max_texture_width);
+            if (info.max_texture_height > 0)
+                limit = std::min(limit, info.max_texture_height);
+        }
+        return limit;
+    }
+
+    static void free_images(std::vector<Image> &images)
+    {
+        for (Image &image : images)
+            SDL_FreeSurface(image.surface);
+        images.clear();
+    }
+
+    std::map<std::string, Sprite> sprites;  // Изображения по имени
+    std::vector<SDL_Texture *> pages;       // Страницы атласа
+    std::vector<SDL_Point> page_sizes;      // Размеры страниц
+    std::vector<std::vector<SDL_Vertex>> batches;  // Вершины пакета по страницам
+    std::vector<int> indices;               // Индексы треугольников пакета
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с ограниченной очередью задач
+// Если очередь заполнена, submit ждет освобождения места, поэтому
+// память под ожидающие задачи не растет независимо от скорости их поступления
+class ThreadPool
+{
+  public:
+    // Параметры:
+    // threads - число рабочих потоков (0 - по числу ядер процессора)
+    // capacity - максимальное число ожидающих задач в очереди
+    ThreadPool(size_t threads, const size_t capacity) : capacity(capacity)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < threads; ++i)
+            workers.emplace_back([this] { work(); });
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Останавливает пул после выполнения всех поставленных задач
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        has_task.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    // Ставит задачу в очередь, ожидая свободного места
+    void submit(std::function<void()> task)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        has_space.wait(lock, [this] { return tasks.size() < capacity; });
+        tasks.push_back(std::move(task));
+        has_task.notify_one();
+    }
+
+    // Ожидает выполнения всех поставленных задач
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        all_done.wait(lock, [this] { return tasks.empty() && running == 0; });
+    }
+
+    // Число рабочих потоков
+    size_t size() const
+    {
+        return workers.size();
+    }
+
+  private:
+    // Цикл рабочего потока: берет задачи из очереди, пока пул не остановлен
+    void work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                has_task.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+                ++running;
+                has_space.notify_one();
+            }
+            task();
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                --running;
+                if (tasks.empty() && running == 0)
+                    all_done.notify_all();
+            }
+        }
+    }
+
+    const size_t capacity;                    // Максимальный размер очереди
+    std::deque<std::function<void()>> tasks;  // Очередь задач
+    std::vector<std::thread> workers;         // Рабочие потоки
+    std::mutex mtx;
+    std::condition_variable has_task;         // В очереди появилась задача
+    std::condition_variable has_space;        // В очереди освободилось место
+    std::condition_variable all_done;         // Все задачи выполнены
+    size_t running = 0;                       // Число выполняющихся задач
+    bool stopping = false;                    // Пул останавливается
+};
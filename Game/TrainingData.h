@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../Models/TrainingRecord.h"
+#include "BinaryFile.h"
+
+// Файл обучающих данных: заголовок и записи training_record подряд без промежутков
+// Заголовок (16 байт): "CKTD", uint32 версия, uint32 размер записи, uint32 0 (резерв)
+// Файл только дополняется, поэтому несколько запусков самоигры могут писать в один файл,
+// а записи можно читать напрямую из отображенного в память файла
+namespace training_data
+{
+const uint32_t VERSION = 1;
+const size_t HEADER_SIZE = 16;
+
+// Проверка заголовка файла, бросает runtime_error при несовпадении формата
+inline void check_header(const char *header, const std::string &path)
+{
+    uint32_t fields[3];
+    std::memcpy(fields, header + 4, sizeof(fields));
+    if (std::memcmp(header, "CKTD", 4) != 0 || fields[0] != VERSION || fields[1] != sizeof(training_record))
+        throw std::runtime_error("bad training data header in '" + path + "'");
+}
+
+// Заголовок нового файла
+inline std::string header()
+{
+    const uint32_t fields[3] = {VERSION, sizeof(training_record), 0};
+    return std::string("CKTD", 4) + std::string(reinterpret_cast<const char *>(fields), sizeof(fields));
+}
+
+// Размер начала файла из заголовка и целых записей (недописанная последняя запись не входит)
+inline size_t complete(const size_t bytes)
+{
+    return bytes - (bytes - HEADER_SIZE) % sizeof(training_record);
+}
+} // namespace training_data
+
+// Запись обучающих данных в конец файла (можно вызывать из нескольких потоков)
+class TrainingWriter
+{
+  public:
+    // Открывает файл для дополнения, пустой или новый файл получает заголовок
+    // Недописанная последняя запись (если запись прервалась) отрезается, иначе новые записи
+    // оказались бы сдвинуты относительно границ записей
+    // Бросает runtime_error, если файл не открывается или имеет другой формат
+    explicit TrainingWriter(const std::string &path)
+        : file(path, "training data", training_data::header(),
+               [&path](const char *header) { training_data::check_header(header, path); },
+               [](const char *, const size_t bytes) { return training_data::complete(bytes); })
+    {
+    }
+
+    // Добавляет записи одной партии (записи партии не перемежаются с записями других партий)
+    void append(const std::vector<training_record> &records)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        file.write(records.data(), records.size() * sizeof(training_record));
+        file.flush();
+        written += records.size();
+    }
+
+    // Число записей, добавленных этим объектом
+    uint64_t count() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return written;
+    }
+
+  private:
+    AppendFile file;
+    mutable std::mutex mtx;
+    uint64_t written = 0;
+};
+
+// Чтение обучающих данных: файл отображается в память (на Windows читается целиком),
+// записи доступны по номеру, последовательно (for_each) или случайной выборкой (sample)
+class TrainingReader
+{
+  public:
+    // Бросает runtime_error, если файл не открывается или имеет другой формат
+    explicit TrainingReader(const std::string &path) : file(path, "training data")
+    {
+        if (file.bytes < training_data::HEADER_SIZE)
+            throw std::runtime_error("truncated training data header in '" + path + "'");
+        training_data::check_header(file.data, path);
+        // Недописанная последняя запись (если запись прервалась) не учитывается
+        records = reinterpret_cast<const training_record *>(file.data + training_data::HEADER_SIZE);
+        count = (training_data::complete(file.bytes) - training_data::HEADER_SIZE) / sizeof(training_record);
+    }
+
+    // Число записей в файле
+    size_t size() const
+    {
+        return count;
+    }
+
+    // Запись с номером i
+    const training_record &operator[](const size_t i) const
+    {
+        return records[i];
+    }
+
+    // Последовательный обход всех записей
+    void for_each(const std::function<void(const training_record &)> &f) const
+    {
+        for (size_t i = 0; i < count; ++i)
+            f(records[i]);
+    }
+
+    // Случайная выборка n записей без повторений в случайном порядке
+    // (все записи в перемешанном порядке, если n не меньше их числа)
+    std::vector<training_record> sample(const size_t n, const uint64_t seed) const
+    {
+        std::vector<size_t> index(count);
+        std::iota(index.begin(), index.end(), size_t(0));
+        std::mt19937_64 rng(seed);
+        const size_t take = std::min(n, count);
+        // Частичная перетасовка Фишера-Йетса: перемешиваются только первые take номеров
+        for (size_t i = 0; i < take; ++i)
+            std::swap(index[i], index[i + std::uniform_int_distribution<size_t>(0, count - 1 - i)(rng)]);
+        std::vector<training_record> res;
+        res.reserve(take);
+        for (size_t i = 0; i < take; ++i)
+            res.push_back(records[index[i]]);
+        return res;
+    }
+
+  private:
+    MappedFile file;
+    const training_record *records = nullptr;
+    size_t count = 0;
+};
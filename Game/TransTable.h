@@ -0,0 +1,333 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Таблица транспозиций: результаты поиска по хешу позиции
+// Таблица может использоваться несколькими потоками одновременно без блокировок:
+// каждая запись хранит данные и XOR ключа с данными, поэтому запись, поврежденная
+// одновременной записью из двух потоков, просто не пройдет проверку ключа
+// Таблица не очищается между ходами: каждый поиск начинается с new_search(), и записи
+// прошлых поисков (другого поколения) уступают место новым, но остаются доступны, пока не вытеснены
+//
+// Таблица может находиться в именованной разделяемой памяти POSIX (attach): тогда ее
+// используют все процессы движка на машине, подключенные к тому же имени. Проверка записей
+// та же, что и между потоками, поэтому блокировки между процессами не нужны. Сегмент
+// остается в системе после выхода процессов, пока его не удалит remove_shared
+// (консольный режим "hashclean"). На Windows разделяемая таблица не поддерживается
+class TransTable
+{
+  public:
+    // Тип оценки в записи
+    enum Bound : uint8_t
+    {
+        NONE = 0,   // Пустая запись
+        EXACT = 1,  // Точная оценка
+        LOWER = 2,  // Оценка не меньше сохраненной (было отсечение по beta)
+        UPPER = 3   // Оценка не больше сохраненной (ни один ход не превысил alpha)
+    };
+
+    // Распакованная запись таблицы
+    struct Entry
+    {
+        int score = 0;        // Оценка с точки зрения ходящего игрока
+        int depth = -1;       // Оставшаяся глубина, на которую получена оценка
+        Bound bound = NONE;   // Тип оценки
+        int move = -1;        // Код лучшего хода (см. Logic::chain_code), -1 если нет
+    };
+
+    // Параметр size_mb - размер таблицы в мегабайтах (округляется вниз до степени двойки записей)
+    explicit TransTable(const size_t size_mb = 16)
+    {
+        resize(size_mb);
+    }
+
+    TransTable(const TransTable &) = delete;
+    TransTable &operator=(const TransTable &) = delete;
+
+    ~TransTable()
+    {
+        detach();
+    }
+
+    // Изменение размера таблицы с очисткой (таблица становится собственной таблицей процесса)
+    void resize(const size_t size_mb)
+    {
+        detach();
+        const size_t count = slot_count(size_mb);
+        local = std::vector<Slot>(count);
+        slots = local.data();
+        mask = count - 1;
+        generation = &local_generation;
+    }
+
+    // Подключение к таблице в разделяемой памяти с именем name (например "checkers")
+    // Первый процесс создает сегмент размером size_mb, остальные подключаются к нему
+    // с его размером. Прежнее содержимое собственной таблицы теряется
+    // Бросает runtime_error, если сегмент не создается или имеет другой формат
+    void attach(const std::string &name, const size_t size_mb)
+    {
+#ifndef _WIN32
+        const std::string path = shm_path(name);
+        const size_t count = slot_count(size_mb);
+        size_t bytes = sizeof(SharedHeader) + count * sizeof(Slot);
+        bool created = true;
+        int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno == EEXIST)
+        {
+            created = false;
+            fd = shm_open(path.c_str(), O_RDWR, 0);
+        }
+        if (fd < 0)
+            throw std::runtime_error("can't open shared hash '" + path + "': " + std::strerror(errno));
+        void *mapped = MAP_FAILED;
+        try
+        {
+            if (created)
+            {
+                if (ftruncate(fd, off_t(bytes)) != 0)
+                    throw std::runtime_error("can't size shared hash '" + path + "': " + std::strerror(errno));
+            }
+            else
+                bytes = wait_for_size(fd, path);
+            mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mapped == MAP_FAILED)
+                throw std::runtime_error("can't map shared hash '" + path + "': " + std::strerror(errno));
+            auto *header = static_cast<SharedHeader *>(mapped);
+            if (created)
+            {
+                // Память нового сегмента заполнена нулями, то есть все записи пусты
+                header->version = VERSION;
+                header->count = count;
+                header->magic.store(MAGIC, std::memory_order_release);
+            }
+            else
+                check_header(*header, bytes, path);
+            close(fd);
+        }
+        catch (...)
+        {
+            if (mapped != MAP_FAILED)
+                munmap(mapped, bytes);
+            close(fd);
+            throw;
+        }
+        detach();
+        local = std::vector<Slot>();
+        auto *header = static_cast<SharedHeader *>(mapped);
+        shared = mapped;
+        shared_bytes = bytes;
+        slots = reinterpret_cast<Slot *>(header + 1);
+        mask = header->count - 1;
+        generation = &header->generation;
+#else
+        (void)name;
+        (void)size_mb;
+        throw std::runtime_error("shared hash is not supported on Windows");
+#endif
+    }
+
+    // Удаление сегмента разделяемой памяти с именем name
+    // Подключенные процессы продолжают работать со своим отображением, новые создадут новый сегмент
+    // Возвращает false, если сегмента нет
+    static bool remove_shared(const std::string &name)
+    {
+#ifndef _WIN32
+        return shm_unlink(shm_path(name).c_str()) == 0;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    // Находится ли таблица в разделяемой памяти
+    bool is_shared() const
+    {
+        return shared != nullptr;
+    }
+
+    // Начало нового поиска: записи, сохраненные раньше, становятся старыми
+    // (у разделяемой таблицы поколение общее для всех процессов)
+    void new_search()
+    {
+        generation->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Очистка таблицы (разделяемая таблица очищается для всех процессов)
+    void clear()
+    {
+        for (size_t i = 0; i <= mask; ++i)
+        {
+            slots[i].check.store(0, std::memory_order_relaxed);
+            slots[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Поиск записи по ключу
+    // Возвращает true и заполняет entry, если запись найдена
+    bool probe(const uint64_t key, Entry &entry) const
+    {
+        const Slot &slot = slots[key & mask];
+        const uint64_t data = slot.data.load(std::memory_order_relaxed);
+        const uint64_t check = slot.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || data == 0)
+            return false;
+        entry = unpack(data);
+        return true;
+    }
+
+    // Сохранение результата поиска
+    // Более глубокая запись сохраняется, если это та же позиция или запись текущего поиска,
+    // иначе (новая оценка не менее глубокая или старая запись из прошлого поиска) заменяется
+    void store(const uint64_t key, const int score, const int depth, const Bound bound, const int move)
+    {
+        Slot &slot = slots[key & mask];
+        const uint64_t old_data = slot.data.load(std::memory_order_relaxed);
+        const uint64_t old_check = slot.check.load(std::memory_order_relaxed);
+        const uint8_t gen = uint8_t(generation->load(std::memory_order_relaxed) & GENERATION_MASK);
+        if (old_data != 0 && unpack(old_data).depth > depth &&
+            ((old_check ^ old_data) == key || data_generation(old_data) == gen))
+            return;
+        const uint64_t data = pack(score, depth, bound, move) | (uint64_t(gen) << GENERATION_SHIFT);
+        slot.data.store(data, std::memory_order_relaxed);
+        slot.check.store(key ^ data, std::memory_order_relaxed);
+    }
+
+    // Число записей в таблице
+    size_t size() const
+    {
+        return mask + 1;
+    }
+
+  private:
+    // Ячейка таблицы: данные и XOR ключа с данными
+    struct Slot
+    {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+
+        Slot() = default;
+        Slot(const Slot &) : Slot()
+        {
+        }
+    };
+
+    // Заголовок сегмента разделяемой памяти, за ним идут записи
+    // Признак MAGIC записывается последним, когда заголовок готов
+    struct alignas(64) SharedHeader
+    {
+        std::atomic<uint32_t> magic;
+        uint32_t version;
+        uint64_t count;                   // Число записей (степень двойки)
+        std::atomic<uint32_t> generation; // Поколение текущего поиска, общее для процессов
+    };
+
+    static const uint32_t MAGIC = 0x54544B43;  // "CKTT"
+    static const uint32_t VERSION = 1;
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "shared hash needs lock-free atomics");
+
+    static const int GENERATION_SHIFT = 55;
+    static const uint8_t GENERATION_MASK = 63;
+
+    // Число записей в таблице размером size_mb мегабайт
+    static size_t slot_count(const size_t size_mb)
+    {
+        size_t count = 1;
+        while (count * 2 * sizeof(Slot) <= size_mb * 1024 * 1024)
+            count *= 2;
+        return count;
+    }
+
+    // Имя сегмента для shm_open: начинается с "/"
+    static std::string shm_path(const std::string &name)
+    {
+        return name.empty() || name[0] != '/' ? "/" + name : name;
+    }
+
+#ifndef _WIN32
+    // Ожидание, пока создавший сегмент процесс задаст его размер (не дольше секунды)
+    // Возвращает размер сегмента
+    static size_t wait_for_size(const int fd, const std::string &path)
+    {
+        for (int attempt = 0; attempt < 1000; ++attempt)
+        {
+            struct stat st;
+            if (fstat(fd, &st) != 0)
+                break;
+            if (size_t(st.st_size) > sizeof(SharedHeader))
+                return size_t(st.st_size);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        throw std::runtime_error("shared hash '" + path + "' is not initialized");
+    }
+
+    // Проверка заголовка сегмента, созданного другим процессом (ждет записи признака не дольше секунды)
+    static void check_header(const SharedHeader &header, const size_t bytes, const std::string &path)
+    {
+        for (int attempt = 0; attempt < 1000 && header.magic.load(std::memory_order_acquire) != MAGIC; ++attempt)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (header.magic.load(std::memory_order_acquire) != MAGIC || header.version != VERSION ||
+            header.count == 0 || (header.count & (header.count - 1)) != 0 ||
+            sizeof(SharedHeader) + header.count * sizeof(Slot) > bytes)
+            throw std::runtime_error("bad shared hash header in '" + path + "' (remove it with hashclean)");
+    }
+#endif
+
+    // Отключение от разделяемой памяти
+    void detach()
+    {
+#ifndef _WIN32
+        if (shared)
+            munmap(shared, shared_bytes);
+#endif
+        shared = nullptr;
+        shared_bytes = 0;
+    }
+
+    // Поколение (номер поиска по модулю 64), в котором сохранена запись
+    static uint8_t data_generation(const uint64_t data)
+    {
+        return uint8_t((data >> GENERATION_SHIFT) & GENERATION_MASK);
+    }
+
+    // Упаковка записи в 64 бита: оценка (32 бита), глубина (8 бит), тип оценки (2 бита), ход (13 бит),
+    // поколение (6 бит, добавляется в store)
+    static uint64_t pack(const int score, const int depth, const Bound bound, const int move)
+    {
+        return uint64_t(uint32_t(score)) | (uint64_t(uint8_t(depth)) << 32) | (uint64_t(bound) << 40) |
+               (uint64_t(move + 1) << 42);
+    }
+
+    static Entry unpack(const uint64_t data)
+    {
+        Entry entry;
+        entry.score = int(int32_t(uint32_t(data)));
+        entry.depth = int(uint8_t(data >> 32));
+        entry.bound = Bound((data >> 40) & 3);
+        entry.move = int((data >> 42) & 0x1FFF) - 1;
+        return entry;
+    }
+
+    std::vector<Slot> local;   // Записи собственной таблицы процесса
+    Slot *slots = nullptr;     // Записи (собственные или в разделяемой памяти)
+    size_t mask = 0;
+    std::atomic<uint32_t> local_generation{0};
+    std::atomic<uint32_t> *generation = &local_generation;  // Поколение текущего поиска
+    void *shared = nullptr;    // Отображение сегмента разделяемой памяти (nullptr - таблица своя)
+    size_t shared_bytes = 0;
+};
@@ -0,0 +1,233 @@
+#pragma once
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "../Models/EvalWeights.h"
+#include "BatchEval.h"
+#include "Logic.h"
+#include "Options.h"
+#include "ThreadPool.h"
+#include "TrainingData.h"
+
+// Настройка весов материальной оценки по итогам партий (режим "tune", метод Texel)
+// Оценка позиции s переводится в ожидаемый итог для ходящего игрока p = 1 / (1 + 10^(-K * s / 400)),
+// подбираются веса, при которых среднеквадратичное отклонение p от итогов партий минимально.
+// Оценка зависит только от отношения весов, поэтому вес шашки фиксирован (1), настраиваются
+// добавка за строку и вес дамки. Сначала по текущим весам подбирается K, затем веса
+// оптимизируются градиентным спуском (Adam); градиент по всем записям на каждом шаге
+// считается параллельно по частям файла, отображенного в память
+class Tuner
+{
+  public:
+    // Запуск настройки
+    // Параметры командной строки: <файл обучающих данных> и
+    // --threads N - число потоков (по умолчанию по числу ядер)
+    // --iterations N - число шагов градиентного спуска (по умолчанию 300)
+    // --rate R - шаг Adam (по умолчанию 0.01)
+    // --out FILE - файл настроенных весов (по умолчанию eval_weights.json)
+    // Возвращает 0 при успехе, 1 при ошибке в параметрах
+    int run(const int argc, char *argv[])
+    {
+        if (argc < 1 || argc % 2 == 0)
+        {
+            cerr << "tune: usage: tune <file> [--threads N] [--iterations N] [--rate R] [--out FILE]" << endl;
+            return 1;
+        }
+        size_t threads = 0;
+        int iterations = 300;
+        double rate = 0.01;
+        string out = "eval_weights.json";
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            string arg = argv[i], value = argv[i + 1];
+            bool valid = true;
+            if (arg == "--threads")
+                valid = Options::parse_number(value, threads, size_t(0), size_t(1024));
+            else if (arg == "--iterations")
+                valid = Options::parse_number(value, iterations, 1, 1000000);
+            else if (arg == "--rate")
+                valid = Options::parse_number(value, rate, 1e-12, 1e6);
+            else if (arg == "--out")
+                out = value;
+            else
+            {
+                cerr << "tune: unknown option " << arg << endl;
+                return 1;
+            }
+            if (!valid)
+            {
+                cerr << "tune: bad value '" << value << "' of " << arg << endl;
+                return 1;
+            }
+        }
+
+        TrainingReader reader(argv[0]);
+        if (reader.size() == 0)
+        {
+            cerr << "tune: no records in " << argv[0] << endl;
+            return 1;
+        }
+        ThreadPool pool(threads, 64);
+        const auto start = chrono::steady_clock::now();
+
+        // Начальные веса - веса по умолчанию в единицах шашки
+        const eval_weights defaults;
+        double params[2] = {double(defaults.advance) / defaults.man, double(defaults.king) / defaults.man};
+        fit_k(reader, pool, params);
+        const double initial_loss = loss(reader, pool, params, nullptr);
+        cout << "Records : " << reader.size() << "\n";
+        cout << "K       : " << k << "\n";
+        cout << "Initial : advance " << params[0] << ", king " << params[1] << ", loss " << initial_loss << endl;
+
+        // Adam
+        double m[2] = {0, 0}, v[2] = {0, 0};
+        const double beta1 = 0.9, beta2 = 0.999, eps = 1e-12;
+        for (int it = 1; it <= iterations; ++it)
+        {
+            double grad[2];
+            const double l = loss(reader, pool, params, grad);
+            for (int j = 0; j < 2; ++j)
+            {
+                m[j] = beta1 * m[j] + (1 - beta1) * grad[j];
+                v[j] = beta2 * v[j] + (1 - beta2) * grad[j] * grad[j];
+                const double m_hat = m[j] / (1 - pow(beta1, it)), v_hat = v[j] / (1 - pow(beta2, it));
+                params[j] -= rate * m_hat / (sqrt(v_hat) + eps);
+            }
+            // Шашка не дешевле, чем на первой строке, дамка не дешевле шашки
+            params[0] = max(params[0], 0.0);
+            params[1] = max(params[1], 1.0);
+            if (it % 50 == 0 || it == iterations)
+                cerr << "tune: iteration " << it << " loss " << l << " advance " << params[0] << " king "
+                     << params[1] << endl;
+        }
+
+        const eval_weights tuned = to_weights(params);
+        const double tuned_params[2] = {double(tuned.advance) / tuned.man, double(tuned.king) / tuned.man};
+        cout << "Tuned   : advance " << tuned_params[0] << ", king " << tuned_params[1] << ", loss "
+             << loss(reader, pool, tuned_params, nullptr) << "\n";
+        ofstream fout(out, ios_base::trunc);
+        fout << json{{"Man", tuned.man}, {"Advance", tuned.advance}, {"King", tuned.king}}.dump(4) << endl;
+        if (!fout)
+        {
+            cerr << "tune: can't write " << out << endl;
+            return 1;
+        }
+        cout << "Time (s): " << int64_t(chrono::duration<double>(chrono::steady_clock::now() - start).count())
+             << "\n";
+        cout << "Output  : " << out << " (set \"EvalWeights\" in settings.json)" << endl;
+        return 0;
+    }
+
+    // Перевод весов в единицах шашки в целые веса файла (шашка - 100 единиц)
+    static eval_weights to_weights(const double params[2])
+    {
+        eval_weights res;
+        res.man = 100;
+        res.advance = int(lround(params[0] * 100));
+        res.king = int(lround(params[1] * 100));
+        return res;
+    }
+
+  private:
+    static constexpr size_t SLICES_PER_THREAD = 4;  // Число частей записей на поток пула при подсчете ошибки
+    static constexpr size_t MIN_CHUNK = 1024;       // Минимальный размер части (меньшие не окупают постановку в пул)
+
+    // Частичные суммы по части записей
+    struct partial
+    {
+        double loss = 0;
+        double grad[2] = {0, 0};
+        uint64_t count = 0;
+    };
+
+    // Среднеквадратичная ошибка предсказания итогов по всем записям при весах params
+    // Если grad не nullptr, в него записывается градиент ошибки по params
+    // Позиции, где у одной из сторон нет фигур, не учитываются (их оценка не зависит от весов)
+    double loss(const TrainingReader &reader, ThreadPool &pool, const double params[2], double *grad) const
+    {
+        // Несколько частей на поток пула, чтобы потоки были заняты и при небольшом числе записей
+        const size_t slices = pool.size() * SLICES_PER_THREAD;
+        const size_t chunk = max<size_t>(MIN_CHUNK, (reader.size() + slices - 1) / slices);
+        const size_t chunks = (reader.size() + chunk - 1) / chunk;
+        vector<partial> parts(chunks);
+        for (size_t c = 0; c < chunks; ++c)
+        {
+            pool.submit([&, c] {
+                const size_t end = min(reader.size(), (c + 1) * chunk);
+                for (size_t i = c * chunk; i < end; ++i)
+                    add_record(reader[i], params, grad != nullptr, parts[c]);
+            });
+        }
+        pool.wait();
+        partial total;
+        for (const auto &part : parts)
+        {
+            total.loss += part.loss;
+            total.grad[0] += part.grad[0];
+            total.grad[1] += part.grad[1];
+            total.count += part.count;
+        }
+        if (total.count == 0)
+            return 0;
+        if (grad)
+        {
+            grad[0] = total.grad[0] / total.count;
+            grad[1] = total.grad[1] / total.count;
+        }
+        return total.loss / total.count;
+    }
+
+    // Учет одной записи в частичных суммах
+    void add_record(const training_record &rec, const double params[2], const bool with_grad, partial &part) const
+    {
+        BatchEval::Packed packed;
+        packed.men[0] = rec.men[0];
+        packed.men[1] = rec.men[1];
+        packed.kings[0] = rec.kings[0];
+        packed.kings[1] = rec.kings[1];
+        const auto mat = BatchEval::count_scalar(packed);
+        const int me = rec.color ? 1 : 0, op = 1 - me;
+        if (mat.men[me] + mat.kings[me] == 0 || mat.men[op] + mat.kings[op] == 0)
+            return;
+        // Материал сторон и оценка как в Logic::evaluate: SCORE_SCALE * (me - op) / (me + op)
+        const double a = mat.men[me] + params[0] * mat.rows[me] + params[1] * mat.kings[me];
+        const double b = mat.men[op] + params[0] * mat.rows[op] + params[1] * mat.kings[op];
+        const double score = SCORE_SCALE * (a - b) / (a + b);
+        const double p = 1 / (1 + pow(10.0, -k * score / 400));
+        const double target = (rec.result + 1) / 2.0;
+        part.loss += (p - target) * (p - target);
+        ++part.count;
+        if (!with_grad)
+            return;
+        // Производная ошибки по оценке, затем по материалу сторон и по весам
+        const double d_score = 2 * (p - target) * p * (1 - p) * log(10.0) * k / 400;
+        const double d_a = SCORE_SCALE * 2 * b / ((a + b) * (a + b));
+        const double d_b = -SCORE_SCALE * 2 * a / ((a + b) * (a + b));
+        part.grad[0] += d_score * (d_a * mat.rows[me] + d_b * mat.rows[op]);
+        part.grad[1] += d_score * (d_a * mat.kings[me] + d_b * mat.kings[op]);
+    }
+
+    // Подбор K при текущих весах поиском золотого сечения на [0.01, 10]
+    void fit_k(const TrainingReader &reader, ThreadPool &pool, const double params[2])
+    {
+        const double phi = (sqrt(5.0) - 1) / 2;
+        double lo = 0.01, hi = 10;
+        for (int it = 0; it < 40; ++it)
+        {
+            const double k1 = hi - phi * (hi - lo), k2 = lo + phi * (hi - lo);
+            k = k1;
+            const double l1 = loss(reader, pool, params, nullptr);
+            k = k2;
+            const double l2 = loss(reader, pool, params, nullptr);
+            if (l1 < l2)
+                hi = k2;
+            else
+                lo = k1;
+        }
+        k = (lo + hi) / 2;
+    }
+
+    double k = 1;  // Масштаб оценки в логистической функции
+};
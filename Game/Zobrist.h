@@ -0,0 +1,90 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "../Models/Move.h"
+#include "Rules.h"
+
+// Хеширование позиций по Зобристу
+// Каждой паре (клетка, тип шашки) и очереди хода черных соответствует случайное 64-битное число,
+// хеш позиции - XOR чисел всех шашек на доске. Хеш легко обновляется после хода и позволяет
+// быстро сравнивать позиции (повторения, таблица транспозиций)
+// Параметр Rules - вариант правил (см. Rules.h), задает размер доски
+template <class Rules> class BasicZobrist
+{
+  public:
+    // Хеш позиции
+    // Параметры:
+    // mtx - состояние доски
+    // color - чей ход (true - черные, false - белые)
+    static uint64_t hash(const std::vector<std::vector<POS_T>> &mtx, const bool color)
+    {
+        uint64_t h = color ? keys().side : 0;
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
+        {
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
+            {
+                if (mtx[i][j])
+                    h ^= piece(i, j, mtx[i][j]);
+            }
+        }
+        return h;
+    }
+
+    // Хеш позиции после полного хода, вычисленный по хешу до хода
+    // Параметры:
+    // h - хеш позиции до хода
+    // mtx - доска до хода
+    // next_mtx - доска после хода
+    // chain - выполненный полный ход
+    template <class Chain>
+    static uint64_t update(uint64_t h, const std::vector<std::vector<POS_T>> &mtx,
+                           const std::vector<std::vector<POS_T>> &next_mtx, const Chain &chain)
+    {
+        h ^= keys().side;
+        h ^= piece(chain.x(), chain.y(), mtx[chain.x()][chain.y()]);
+        h ^= piece(chain.x2(), chain.y2(), next_mtx[chain.x2()][chain.y2()]);
+        for (const auto &cell : chain.captured)
+            h ^= piece(cell.first, cell.second, mtx[cell.first][cell.second]);
+        return h;
+    }
+
+    // Случайное число для шашки типа type в клетке (i, j)
+    static uint64_t piece(const POS_T i, const POS_T j, const POS_T type)
+    {
+        return keys().pieces[i * Rules::SIZE + j][type];
+    }
+
+  private:
+    struct Keys
+    {
+        std::array<std::array<uint64_t, 5>, Rules::SIZE * Rules::SIZE> pieces;
+        uint64_t side;
+    };
+
+    // Таблица случайных чисел, одинаковая при каждом запуске (генератор splitmix64)
+    static const Keys &keys()
+    {
+        static const Keys table = [] {
+            Keys k{};
+            uint64_t state = 0x9E3779B97F4A7C15ull;
+            auto next = [&state] {
+                uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                return z ^ (z >> 31);
+            };
+            for (auto &cell : k.pieces)
+            {
+                for (POS_T type = 1; type < 5; ++type)
+                    cell[type] = next();
+            }
+            k.side = next();
+            return k;
+        }();
+        return table;
+    }
+};
+
+typedef BasicZobrist<RussianRules> Zobrist;
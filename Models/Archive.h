@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Заголовок партии в архиве (см. Game/Archive.h), за ним идут size байт упакованных ходов
+struct archive_game
+{
+    uint32_t time;        // Время окончания партии (секунды с 1970 года)
+    uint16_t plies;       // Число полуходов (полных ходов одной стороны)
+    uint16_t size;        // Размер упакованных ходов в байтах
+    int8_t result;        // Итог для белых: 1 - победа, 0 - ничья, -1 - поражение
+    uint8_t reserved[3];  // Нули
+};
+
+static_assert(sizeof(archive_game) == 12, "archive_game must stay 12 bytes: it is the file format");
+
+// Запись индекса позиций: позиция встретилась в партии архива
+struct archive_posting
+{
+    uint64_t hash;     // Хеш позиции по Зобристу (с очередью хода)
+    uint32_t game;     // Номер партии в архиве
+    uint16_t ply;      // Число полуходов до позиции (0 - начальная расстановка)
+    int8_t result;     // Итог партии для белых
+    uint8_t reserved;  // Ноль
+};
+
+static_assert(sizeof(archive_posting) == 16, "archive_posting must stay 16 bytes: it is the file format");
+
+// Статистика позиции по архиву
+struct position_stats
+{
+    uint64_t games = 0;  // Число партий, в которых встретилась позиция
+    uint64_t white = 0;  // Из них выиграно белыми
+    uint64_t draws = 0;  // Закончено вничью
+    uint64_t black = 0;  // Выиграно черными
+    std::vector<std::pair<uint32_t, uint16_t>> postings;  // Первые вхождения: (номер партии, полуход)
+};
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// Профиль уровня сложности бота
+// Глубина ограничивает силу игры, а число позиций и время - задержку ответа,
+// поэтому время хода на любом уровне ограничено независимо от позиции
+struct difficulty_profile
+{
+    int depth = 1;          // Максимальная глубина итеративного углубления
+    uint64_t nodes = 0;     // Максимальное число позиций на ход (0 - без ограничения)
+    int64_t time_ms = 0;    // Максимальное время на ход в миллисекундах (0 - без ограничения)
+    int noise = 0;          // Амплитуда случайной добавки к оценке листьев (шашка - примерно 400)
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+// Веса материальной оценки "NumberAndPotential" в целых условных единицах
+// Оценка зависит только от отношения материала сторон, поэтому важно только отношение весов
+struct eval_weights
+{
+    int man = 20;     // Простая шашка на своей первой строке
+    int advance = 1;  // Добавка к шашке за каждую пройденную строку
+    int king = 100;   // Дамка
+};
@@ -1,5 +1,8 @@
 #pragma once
+#include <memory>
 #include <stdlib.h>
+#include <utility>
+#include <vector>
 
 // Тип для хранения координат на доске (8-битное целое число со знаком)
 typedef int8_t POS_T;
@@ -34,3 +37,42 @@ struct move_pos
         return !(*this == other);
     }
 };
+
+// Полный ход: вся цепочка шагов одной шашки (несколько шагов при серии взятий)
+// и множество побитых ею шашек
+// Параметр Alloc - распределитель памяти для шагов и побитых шашек (в поиске - арена, см. Game/Arena.h)
+template <class Alloc = std::allocator<move_pos>> struct basic_move_chain
+{
+    using cell_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<POS_T, POS_T>>;
+
+    std::vector<move_pos, Alloc> path;                       // Шаги хода по порядку
+    std::vector<std::pair<POS_T, POS_T>, cell_alloc> captured;  // Координаты побитых шашек
+
+    // Начальная клетка хода
+    POS_T x() const
+    {
+        return path.front().x;
+    }
+    POS_T y() const
+    {
+        return path.front().y;
+    }
+
+    // Конечная клетка хода
+    POS_T x2() const
+    {
+        return path.back().x2;
+    }
+    POS_T y2() const
+    {
+        return path.back().y2;
+    }
+
+    // Является ли ход взятием
+    bool is_beat() const
+    {
+        return !captured.empty();
+    }
+};
+
+typedef basic_move_chain<> move_chain;
@@ -0,0 +1,11 @@
+#pragma once
+#include <vector>
+
+#include "Move.h"
+
+// Позиция в партии: состояние доски и очередь хода
+struct game_position
+{
+    std::vector<std::vector<POS_T>> mtx;  // Состояние доски
+    bool color = false;                   // Чей ход: true - черные, false - белые
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Move.h"
+
+// Итог доказательства с точки зрения ходящего игрока
+enum class Proof
+{
+    UNKNOWN, // Не доказано за отведенное число позиций (ничья или слишком длинный вариант)
+    WON,     // Ходящий выигрывает при любой защите
+    LOST     // Ходящий проигрывает при любой игре
+};
+
+// Результат решателя (см. Game/Solver.h)
+struct proof_info
+{
+    Proof result = Proof::UNKNOWN;
+    uint64_t proof_size = 0;     // Число узлов дерева доказательства (0, если не доказано)
+    uint64_t nodes = 0;          // Число раскрытых позиций
+    std::vector<move_pos> best;  // Выигрывающий полный ход (при WON)
+};
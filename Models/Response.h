@@ -7,5 +7,6 @@ enum class Response
     BACK,   // Отмена последнего хода
     REPLAY, // Начать игру заново
     QUIT,   // Выход из игры
-    CELL    // Выбор клетки на доске
+    CELL,   // Выбор клетки на доске
+    HINT    // Показать подсказку (лучший ход)
 };
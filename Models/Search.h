@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Move.h"
+
+// Ограничения поиска лучшего хода (0 - без ограничения)
+struct search_limits
+{
+    int depth = 0;         // Максимальная глубина итеративного углубления
+    uint64_t nodes = 0;    // Максимальное число рассматриваемых позиций
+    int64_t time_ms = 0;   // Максимальное время поиска в миллисекундах
+};
+
+// Один из лучших ходов поиска с несколькими вариантами (multi-PV)
+struct search_line
+{
+    int score = 0;                 // Оценка хода с точки зрения ходящего игрока
+    std::vector<move_pos> move;    // Полный ход
+};
+
+// Результат завершенной итерации поиска
+struct search_info
+{
+    int depth = 0;                 // Глубина итерации
+    int score = 0;                 // Оценка лучшего хода с точки зрения ходящего игрока
+    uint64_t nodes = 0;            // Число позиций, рассмотренных с начала поиска
+    int64_t time_ms = 0;           // Время с начала поиска в миллисекундах
+    std::vector<move_pos> best;    // Лучший полный ход
+    std::vector<search_line> lines;  // Лучшие ходы по убыванию оценки, первый - best (только при Logic::multi_pv > 1)
+};
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+// Запись обучающих данных: позиция партии самоигры, оценка поиска и итог партии
+// Позиция хранится в виде масок по 32 черным клеткам, как в BatchEval::Packed:
+// клетка (i, j) - бит i * 4 + j / 2. Оценка и итог даны с точки зрения ходящего игрока
+struct training_record
+{
+    uint32_t men[2];    // Маски простых шашек: индекс 0 - белые, 1 - черные
+    uint32_t kings[2];  // Маски дамок
+    int16_t score;      // Оценка поиска (выигрыш и проигрыш - +-SCORE_SCALE)
+    uint8_t color;      // Чей ход: 1 - черные, 0 - белые
+    int8_t result;      // Итог партии: 1 - ходящий игрок выиграл, 0 - ничья, -1 - проиграл
+};
+
+static_assert(sizeof(training_record) == 20, "training_record must stay 20 bytes: it is the file format");
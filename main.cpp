@@ -1,9 +1,89 @@
+#include "Game/Analyzer.h"
+#include "Game/Archive.h"
+#include "Game/Bench.h"
+#include "Game/Engine.h"
 #include "Game/Game.h"
+#include "Game/Perft.h"
+#include "Game/SelfPlay.h"
+#include "Game/Solver.h"
+#include "Game/Server.h"
+#include "Game/Spectator.h"
+#include "Game/Tuner.h"
+
+#ifndef NDEBUG
+// Отладочная сборка: все выделения памяти в куче проходят через счетчик Arena::heap_allocations,
+// чтобы проверить, что поиск после прогрева не обращается к куче (режим bench)
+// noinline: иначе GCC после встраивания принимает пары new/delete за несовпадающие (-Wmismatched-new-delete)
+[[gnu::noinline]] void *operator new(size_t size)
+{
+    Arena::heap_allocations().fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+#endif
 
 int main(int argc, char* argv[])
 {
-    Game g;
-    g.play();
+    // Консольные режимы без графического интерфейса
+    if (argc > 1 && string(argv[1]) == "bench")
+        return Bench().run(argc - 2, argv + 2);
+    if (argc > 1 && string(argv[1]) == "analyze")
+        return Analyzer().run(argc - 2, argv + 2);
+    if (argc > 1 && string(argv[1]) == "engine")
+        return Engine().run();
+    if (argc > 1 && string(argv[1]) == "server")
+        return Server().run(argc - 2, argv + 2);
+    if (argc > 1 && string(argv[1]) == "selfplay")
+        return SelfPlay().run(argc - 2, argv + 2);
+    if (argc > 1 && string(argv[1]) == "dataset")
+        return SelfPlay().inspect(argc - 2, argv + 2);
+    if (argc > 1 && string(argv[1]) == "tune")
+        return Tuner().run(argc - 2, argv + 2);
+    if (argc > 1 && string(argv[1]) == "perft")
+        return Perft().run(argc - 2, argv + 2);
+    if (argc > 1 && string(argv[1]) == "solve")
+        return Solver().run(argc - 2, argv + 2);
+    if (argc > 1 && string(argv[1]) == "archive")
+        return Archive().run(argc - 2, argv + 2);
+    if (argc > 1 && string(argv[1]) == "watch")
+        return Spectator().run(argc - 2, argv + 2);
+    if (argc > 2 && string(argv[1]) == "hashclean")
+    {
+        // Удаление таблицы транспозиций в разделяемой памяти, оставшейся после процессов игры
+        if (!TransTable::remove_shared(argv[2]))
+        {
+            cerr << "hashclean: can't remove shared hash '" << argv[2] << "': " << strerror(errno) << endl;
+            return 1;
+        }
+        cout << "hashclean: removed shared hash '" << argv[2] << "'" << endl;
+        return 0;
+    }
+
+    // Ошибки настроек (например, неверное значение в settings.json) записываются в лог,
+    // а не завершают программу аварийно
+    try
+    {
+        Game g;
+        g.play();
+    }
+    catch (const exception &e)
+    {
+        ofstream fout(project_path + "log.txt", ios_base::app);
+        fout << "Error: " << e.what() << endl;
+        cerr << "checkers: " << e.what() << endl;
+        return 1;
+    }
 
     return 0;
 }